@@ -3,8 +3,10 @@
 #include <inttypes.h>
 #include <round.h>
 #include <stdio.h>
+#include "intrinsic.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
+#include "threads/profile.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
 
@@ -17,16 +19,96 @@
 #error TIMER_FREQ <= 1000 recommended
 #endif
 
+/* 8254 input clock frequency, in Hz. */
+#define PIT_HZ 1193180
+
+/* 8254 counts per timer tick: PIT_HZ divided by TIMER_FREQ,
+   rounded to nearest. */
+#define PIT_TICK_COUNT ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
+static struct seqlock ticks_seq;        /* Protects `ticks'. */
+
+#define NS_PER_SEC 1000000000LL
+#define NS_PER_TICK (NS_PER_SEC / TIMER_FREQ)
+
+/* TSC clock source, calibrated against the PIT by
+   timer_calibrate().  Until then timer_ns() counts whole ticks.
+   Afterward it returns NS_BASE plus the TSC cycles since
+   TSC_BASE, times TSC_MULT / 2**32. */
+#define TSC_CALIBRATE_TICKS 10  /* Ticks to count TSC cycles over. */
+static uint64_t tsc_hz;         /* TSC cycles per second. */
+static uint64_t tsc_base;       /* TSC when calibrated. */
+static int64_t ns_base;         /* timer_ns() at TSC_BASE. */
+static uint64_t tsc_mult;       /* Nanoseconds per cycle, times 2**32. */
+static bool tsc_invariant;      /* Does the TSC tick at a fixed rate? */
+
+/* High-resolution timers, ordered by expiry.  When the first one
+   expires before the next tick, the PIT is switched to one-shot
+   mode to interrupt at that time, then once more at the time the
+   next tick was due, when it goes back to periodic mode.  Sleeps
+   shorter than HRTIMER_SPIN_NS spin on the TSC instead, because
+   taking the extra interrupts would cost more. */
+#define HRTIMER_SPIN_NS 20000
+static struct rb_tree hrtimers;
+static bool hr_one_shot;        /* PIT in one-shot mode for hrtimers? */
+static int64_t hr_tick_due;     /* When the next tick is due, if so. */
+static long long hr_fired;      /* # of hrtimers fired. */
+static long long hr_interrupts; /* # of between-tick interrupts. */
 
-/* Number of loops per timer tick.
-   Initialized by timer_calibrate(). */
-static unsigned loops_per_tick;
+/* Hierarchical timer wheel of pending timer events.
+
+   Level 0 has one slot per tick for the next WHEEL_SIZE ticks.
+   Each slot of level N covers WHEEL_SIZE^N ticks, so an event is
+   filed at the lowest level whose range reaches its expiry.
+   Whenever the level 0 index wraps around, the current slot of
+   level 1 is "cascaded", that is, its events are refiled into
+   level 0, and so on up the levels.  An event is cascaded at
+   most WHEEL_LEVELS - 1 times, so the per-tick cost is O(1)
+   plus the number of expiring events, amortized.  Events further
+   out than the top level can reach are parked in its last slot
+   and refiled when it is cascaded. */
+#define WHEEL_BITS 6
+#define WHEEL_SIZE (1 << WHEEL_BITS)    /* Slots per level. */
+#define WHEEL_MASK (WHEEL_SIZE - 1)
+#define WHEEL_LEVELS 4                  /* Covers 2^24 ticks. */
+
+static struct list wheel[WHEEL_LEVELS][WHEEL_SIZE];
+static int64_t wheel_base;              /* Next tick to process. */
+
+/* Tickless idle.  While only the idle thread is runnable, the
+   PIT is switched from periodic mode to a single interrupt at
+   the next timer event, as far ahead as its 16-bit counter
+   reaches.  See timer_tickless_enter() and
+   timer_tickless_exit(). */
+#define TICKLESS_MAX_SKIP (0xffff / PIT_TICK_COUNT)
+
+bool timer_tickless;            /* -tickless: allow tickless idle? */
+static bool tickless_active;    /* Is the PIT in one-shot mode? */
+static int64_t tickless_skip;   /* Ticks spanned by the one-shot. */
+static unsigned tickless_carry; /* PIT counts lost to phase resets. */
+static long long tickless_periods; /* # of tickless idle periods. */
+static long long tickless_skipped; /* # of tick interrupts avoided. */
 
 static intr_handler_func timer_interrupt;
-static bool too_many_loops (unsigned loops);
-static void busy_wait (int64_t loops);
+static void tick_advance (void);
+static void pit_periodic (void);
+static void pit_one_shot (uint16_t count);
+static bool pit_expired (void);
+static uint16_t pit_read_count (void);
+static void wheel_insert (struct timer_event *);
+static void wheel_cascade (int level, int index);
+static bool wheel_cascade_empty (int64_t tick);
+static int64_t wheel_ticks_until_next (int64_t limit);
+static void wheel_run (int64_t now);
+static bool tsc_is_invariant (void);
+static bool pit_irq_pending (void);
+static uint16_t pit_ns_to_counts (int64_t ns);
+static bool hrtimer_less (const struct rb_node *, const struct rb_node *,
+		void *aux);
+static void hrtimer_run (void);
+static void hrtimer_program (void);
 static void real_time_sleep (int64_t num, int32_t denom);
 
 /* Sets up the 8254 Programmable Interval Timer (PIT) to
@@ -34,50 +116,62 @@ static void real_time_sleep (int64_t num, int32_t denom);
    corresponding interrupt. */
 void
 timer_init (void) {
-	/* 8254 input frequency divided by TIMER_FREQ, rounded to
-	   nearest. */
-	uint16_t count = (1193180 + TIMER_FREQ / 2) / TIMER_FREQ;
+	seqlock_init (&ticks_seq);
+	pit_periodic ();
 
-	outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
-	outb (0x40, count & 0xff);
-	outb (0x40, count >> 8);
+	for (int level = 0; level < WHEEL_LEVELS; level++)
+		for (int slot = 0; slot < WHEEL_SIZE; slot++)
+			list_init (&wheel[level][slot]);
+	wheel_base = ticks;
+	rb_init (&hrtimers, hrtimer_less, NULL);
 
 	intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
 
-/* Calibrates loops_per_tick, used to implement brief delays. */
+/* Calibrates the TSC against the PIT, by counting TSC cycles
+   over TSC_CALIBRATE_TICKS timer ticks, and switches timer_ns()
+   over to it. */
 void
 timer_calibrate (void) {
-	unsigned high_bit, test_bit;
+	int64_t start, end;
+	uint64_t tsc_start, tsc_end;
 
 	ASSERT (intr_get_level () == INTR_ON);
 	printf ("Calibrating timer...  ");
 
-	/* Approximate loops_per_tick as the largest power-of-two
-	   still less than one timer tick. */
-	loops_per_tick = 1u << 10;
-	while (!too_many_loops (loops_per_tick << 1)) {
-		loops_per_tick <<= 1;
-		ASSERT (loops_per_tick != 0);
-	}
+	/* Start and end right after a tick. */
+	start = timer_ticks ();
+	while (timer_ticks () == start)
+		barrier ();
+	tsc_start = rdtsc ();
+	start = timer_ticks ();
+	while ((end = timer_ticks ()) - start < TSC_CALIBRATE_TICKS)
+		barrier ();
+	tsc_end = rdtsc ();
 
-	/* Refine the next 8 bits of loops_per_tick. */
-	high_bit = loops_per_tick;
-	for (test_bit = high_bit >> 1; test_bit != high_bit >> 10; test_bit >>= 1)
-		if (!too_many_loops (high_bit | test_bit))
-			loops_per_tick |= test_bit;
+	tsc_base = tsc_end;
+	ns_base = end * NS_PER_TICK;
+	tsc_mult = ((uint64_t) NS_PER_SEC << 32)
+		/ ((tsc_end - tsc_start) * TIMER_FREQ / (end - start));
+	tsc_invariant = tsc_is_invariant ();
+	barrier ();
+	tsc_hz = (tsc_end - tsc_start) * TIMER_FREQ / (end - start);
 
-	printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+	printf ("%'"PRIu64" TSC cycles/s%s.\n", tsc_hz,
+			tsc_invariant ? "" : " (TSC not invariant)");
 }
 
 /* Returns the number of timer ticks since the OS booted. */
 int64_t
 timer_ticks (void) {
-	enum intr_level old_level = intr_disable (); 
-	int64_t t = ticks;
-	intr_set_level (old_level); 
-	barrier ();
-	return t; 
+	unsigned seq;
+	int64_t t;
+
+	do {
+		seq = seqlock_read_begin (&ticks_seq);
+		t = ticks;
+	} while (seqlock_read_retry (&ticks_seq, seq));
+	return t;
 }
 
 /* Returns the number of timer ticks elapsed since THEN, which
@@ -87,6 +181,23 @@ timer_elapsed (int64_t then) {
 	return timer_ticks () - then;
 }
 
+/* Returns the number of nanoseconds since the OS booted.  The
+   clock is monotonic, and has TSC resolution once
+   timer_calibrate() has run. */
+int64_t
+timer_ns (void) {
+	if (tsc_hz == 0)
+		return timer_ticks () * NS_PER_TICK;
+	return ns_base + timer_cycles_to_ns (rdtsc () - tsc_base);
+}
+
+/* Converts CYCLES of the TSC into nanoseconds.  Returns 0 before
+   timer_calibrate() has run. */
+int64_t
+timer_cycles_to_ns (uint64_t cycles) {
+	return ((unsigned __int128) cycles * tsc_mult) >> 32;
+}
+
 /* Suspends execution for approximately TICKS timer ticks. */
 /*
  * 1. 스레드의 실행을 최소 (ticks) 만큼 중단하는 함수
@@ -126,48 +237,468 @@ timer_nsleep (int64_t ns) {
 void
 timer_print_stats (void) {
 	printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
+	if (hr_fired > 0)
+		printf ("Timer: %lld hrtimers fired, %lld between-tick interrupts\n",
+				hr_fired, hr_interrupts);
+	if (timer_tickless)
+		printf ("Timer: %lld tickless idle periods, %lld tick interrupts "
+				"avoided\n", tickless_periods, tickless_skipped);
 }
 
-/* Timer interrupt handler. */
+/* Called by the idle thread, with interrupts off, just before it
+   halts the CPU.  If tickless idle is enabled and no timer event
+   can fire within the next two ticks, stops the periodic tick
+   and programs the PIT to interrupt once, when the next event
+   is due or as late as the PIT allows.  The first interrupt of
+   any kind ends the tickless period; see
+   timer_tickless_exit(). */
+void
+timer_tickless_enter (void) {
+	int64_t skip;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (!timer_tickless || tickless_active || hr_one_shot)
+		return;
+
+	skip = wheel_ticks_until_next (TICKLESS_MAX_SKIP);
+	if (!rb_empty (&hrtimers)) {
+		struct hrtimer *first = rb_entry (rb_min (&hrtimers), struct hrtimer,
+				node);
+		int64_t until = (first->expires - timer_ns ()) / NS_PER_TICK;
+		if (until < skip)
+			skip = until;
+	}
+	if (skip < 2)
+		return;
+
+	pit_one_shot (skip * PIT_TICK_COUNT);
+	tickless_active = true;
+	tickless_skip = skip;
+	tickless_periods++;
+}
+
+/* Ends the tickless idle period, if any.  Called at the start
+   of every external interrupt, before its handler runs.  Runs
+   thread_tick() once for every tick that passed while the CPU
+   was halted, so that idle_ticks and the scheduler statistics
+   stay exact, fires the timer events that came due, and
+   restores the periodic tick. */
+void
+timer_tickless_exit (void) {
+	int64_t caught_up;
+
+	ASSERT (intr_context ());
+
+	if (!tickless_active)
+		return;
+	tickless_active = false;
+
+	if (pit_expired ()) {
+		/* The one-shot interrupt is being handled right now, or is
+		   pending at the PIC.  timer_interrupt() accounts for its
+		   tick itself. */
+		pit_periodic ();
+		caught_up = tickless_skip - 1;
+	} else {
+		/* Woken early by another device.  Restarting the periodic
+		   tick resets its phase, so carry the partial tick over to
+		   keep `ticks' from drifting. */
+		unsigned span = tickless_skip * PIT_TICK_COUNT;
+		unsigned elapsed = span - pit_read_count ();
+
+		pit_periodic ();
+		tickless_carry += elapsed % PIT_TICK_COUNT;
+		caught_up = elapsed / PIT_TICK_COUNT;
+		caught_up += tickless_carry / PIT_TICK_COUNT;
+		tickless_carry %= PIT_TICK_COUNT;
+	}
+
+	tickless_skipped += caught_up;
+	while (caught_up-- > 0) {
+		tick_advance ();
+		thread_tick (false);
+	}
+	wheel_run (ticks);
+}
+
+/* Programs PIT counter 0 to interrupt TIMER_FREQ times per
+   second.  See [8254] for hardware details. */
 static void
-timer_interrupt (struct intr_frame *args UNUSED) {
-	ticks++;
-	thread_tick ();
-	
-	if(next_to_wake_ticks <= ticks)
-		wake_up(ticks);
+pit_periodic (void) {
+	outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
+	outb (0x40, PIT_TICK_COUNT & 0xff);
+	outb (0x40, PIT_TICK_COUNT >> 8);
+}
 
+/* Programs PIT counter 0 to interrupt once, COUNT input clock
+   cycles from now. */
+static void
+pit_one_shot (uint16_t count) {
+	outb (0x43, 0x30);    /* CW: counter 0, LSB then MSB, mode 0, binary. */
+	outb (0x40, count & 0xff);
+	outb (0x40, count >> 8);
 }
 
-/* Returns true if LOOPS iterations waits for more than one timer
-   tick, otherwise false. */
+/* Returns true if the one-shot count programmed by
+   pit_one_shot() has run out, that is, if counter 0's OUT pin
+   has gone high. */
 static bool
-too_many_loops (unsigned loops) {
-	/* Wait for a timer tick. */
-	int64_t start = ticks;
-	while (ticks == start)
-		barrier ();
+pit_expired (void) {
+	outb (0x43, 0xe2);    /* Read-back: status of counter 0 only. */
+	return (inb (0x40) & 0x80) != 0;
+}
 
-	/* Run LOOPS loops. */
-	start = ticks;
-	busy_wait (loops);
+/* Returns the current value of PIT counter 0. */
+static uint16_t
+pit_read_count (void) {
+	uint8_t lo, hi;
 
-	/* If the tick count changed, we iterated too long. */
-	barrier ();
-	return start != ticks;
+	outb (0x43, 0x00);    /* Counter latch: counter 0. */
+	lo = inb (0x40);
+	hi = inb (0x40);
+	return lo | (hi << 8);
 }
 
-/* Iterates through a simple loop LOOPS times, for implementing
-   brief delays.
+/* Returns true if a timer interrupt is pending at the master
+   PIC but has not been delivered yet. */
+static bool
+pit_irq_pending (void) {
+	outb (0x20, 0x0a);    /* OCW3: read the interrupt request register. */
+	return (inb (0x20) & 0x01) != 0;
+}
 
-   Marked NO_INLINE because code alignment can significantly
-   affect timings, so that if this function was inlined
-   differently in different places the results would be difficult
-   to predict. */
-static void NO_INLINE
-busy_wait (int64_t loops) {
-	while (loops-- > 0)
-		barrier ();
+/* Returns the number of PIT input clock cycles in NS
+   nanoseconds, rounded up and clamped to what a one-shot count
+   can hold. */
+static uint16_t
+pit_ns_to_counts (int64_t ns) {
+	int64_t counts = (ns * PIT_HZ + NS_PER_SEC - 1) / NS_PER_SEC;
+
+	if (counts < 1)
+		return 1;
+	if (counts > 0xffff)
+		return 0xffff;
+	return counts;
+}
+
+/* Returns true if the CPU says that its TSC runs at a constant
+   rate in every power state. */
+static bool
+tsc_is_invariant (void) {
+	uint32_t eax, ebx, ecx, edx;
+
+	asm volatile ("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx)
+			: "a" (0x80000000));
+	if (eax < 0x80000007)
+		return false;
+	asm volatile ("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx)
+			: "a" (0x80000007));
+	return (edx & (1 << 8)) != 0;
+}
+
+/* Initializes timer event EVENT to call FUNC (AUX) when it
+   expires.  The event is not armed. */
+void
+timer_event_init (struct timer_event *event, timer_event_func *func,
+		void *aux) {
+	ASSERT (event != NULL);
+	ASSERT (func != NULL);
+
+	event->func = func;
+	event->aux = aux;
+	event->expires = 0;
+	event->pending = false;
+}
+
+/* Arms EVENT to fire on the first tick at which timer_ticks()
+   >= EXPIRES, rearming it if it is already pending.  An EXPIRES
+   in the past fires on the next tick.  May be called from an
+   interrupt handler, including from an event's own FUNC. */
+void
+timer_event_arm (struct timer_event *event, int64_t expires) {
+	enum intr_level old_level = intr_disable ();
+
+	if (event->pending)
+		list_remove (&event->elem);
+	event->expires = expires;
+	event->pending = true;
+	wheel_insert (event);
+
+	intr_set_level (old_level);
+}
+
+/* Disarms EVENT.  Returns true if it was pending, false if it
+   had already fired or was never armed. */
+bool
+timer_event_cancel (struct timer_event *event) {
+	enum intr_level old_level = intr_disable ();
+	bool was_pending = event->pending;
+
+	if (was_pending) {
+		list_remove (&event->elem);
+		event->pending = false;
+	}
+
+	intr_set_level (old_level);
+	return was_pending;
+}
+
+/* Returns true if EVENT is armed and has not fired yet. */
+bool
+timer_event_pending (const struct timer_event *event) {
+	return event->pending;
+}
+
+/* Initializes high-resolution timer TIMER to call FUNC (AUX)
+   when it expires.  The timer is not armed. */
+void
+hrtimer_init (struct hrtimer *timer, timer_event_func *func, void *aux) {
+	ASSERT (timer != NULL);
+	ASSERT (func != NULL);
+
+	timer->func = func;
+	timer->aux = aux;
+	timer->expires = 0;
+	timer->pending = false;
+}
+
+/* Arms TIMER to fire as soon as timer_ns() >= EXPIRES, rearming
+   it if it is already pending.  An EXPIRES in the past fires on
+   the next timer interrupt.  May be called from an interrupt
+   handler. */
+void
+hrtimer_arm (struct hrtimer *timer, int64_t expires) {
+	enum intr_level old_level = intr_disable ();
+
+	if (timer->pending)
+		rb_remove (&hrtimers, &timer->node);
+	timer->expires = expires;
+	timer->pending = true;
+	rb_insert (&hrtimers, &timer->node);
+	hrtimer_program ();
+
+	intr_set_level (old_level);
+}
+
+/* Disarms TIMER.  Returns true if it was pending, false if it
+   had already fired or was never armed.  If the PIT was set to
+   interrupt for TIMER, it still does, and finds nothing to do. */
+bool
+hrtimer_cancel (struct hrtimer *timer) {
+	enum intr_level old_level = intr_disable ();
+	bool was_pending = timer->pending;
+
+	if (was_pending) {
+		rb_remove (&hrtimers, &timer->node);
+		timer->pending = false;
+	}
+
+	intr_set_level (old_level);
+	return was_pending;
+}
+
+/* Orders hrtimers by expiry. */
+static bool
+hrtimer_less (const struct rb_node *a_, const struct rb_node *b_,
+		void *aux UNUSED) {
+	const struct hrtimer *a = rb_entry (a_, struct hrtimer, node);
+	const struct hrtimer *b = rb_entry (b_, struct hrtimer, node);
+
+	return a->expires < b->expires;
+}
+
+/* Fires every pending hrtimer that has expired. */
+static void
+hrtimer_run (void) {
+	int64_t now = timer_ns ();
+
+	while (!rb_empty (&hrtimers)) {
+		struct hrtimer *timer = rb_entry (rb_min (&hrtimers), struct hrtimer,
+				node);
+		if (timer->expires > now)
+			break;
+
+		rb_remove (&hrtimers, &timer->node);
+		timer->pending = false;
+		hr_fired++;
+		timer->func (timer->aux);
+	}
+}
+
+/* Makes sure the PIT interrupts in time for the first hrtimer:
+   if it expires before the next tick, programs a one-shot
+   interrupt for it.  While in one-shot mode, programs the next
+   interrupt for the first hrtimer or the tick, whichever comes
+   first.  Interrupts must be off. */
+static void
+hrtimer_program (void) {
+	int64_t now, target;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (tsc_hz == 0 || tickless_active)
+		return;
+
+	now = timer_ns ();
+	if (!hr_one_shot) {
+		/* A tick that is pending at the PIC is due right now. */
+		if (pit_irq_pending ())
+			hr_tick_due = now;
+		else
+			hr_tick_due = now + pit_read_count () * NS_PER_SEC / PIT_HZ;
+	}
+
+	target = hr_tick_due;
+	if (!rb_empty (&hrtimers)) {
+		int64_t first = rb_entry (rb_min (&hrtimers), struct hrtimer,
+				node)->expires;
+		if (first < target)
+			target = first;
+	}
+
+	/* In periodic mode, the tick itself is on its way. */
+	if (!hr_one_shot && target == hr_tick_due)
+		return;
+
+	pit_one_shot (pit_ns_to_counts (target - now));
+	hr_one_shot = true;
+}
+
+/* Files EVENT in the wheel slot that covers its expiry. */
+static void
+wheel_insert (struct timer_event *event) {
+	int64_t delta = event->expires - wheel_base;
+	int64_t expires = event->expires;
+	int level, slot;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (delta < 0) {
+		/* Already due: fire on the next tick processed. */
+		expires = wheel_base;
+		delta = 0;
+	} else if (delta >= (int64_t) 1 << (WHEEL_BITS * WHEEL_LEVELS)) {
+		/* Too far out: park in the top level's furthest slot. */
+		delta = ((int64_t) 1 << (WHEEL_BITS * WHEEL_LEVELS)) - 1;
+		expires = wheel_base + delta;
+	}
+
+	for (level = 0; level < WHEEL_LEVELS - 1; level++)
+		if (delta < (int64_t) 1 << (WHEEL_BITS * (level + 1)))
+			break;
+
+	slot = (expires >> (WHEEL_BITS * level)) & WHEEL_MASK;
+	list_push_back (&wheel[level][slot], &event->elem);
+}
+
+/* Refiles every event in slot INDEX of LEVEL into lower levels. */
+static void
+wheel_cascade (int level, int index) {
+	struct list *slot = &wheel[level][index];
+
+	while (!list_empty (slot))
+		wheel_insert (list_entry (list_pop_front (slot),
+					struct timer_event, elem));
+}
+
+/* Returns true if processing TICK does not cascade any event
+   into level 0, false if it might. */
+static bool
+wheel_cascade_empty (int64_t tick) {
+	if ((tick & WHEEL_MASK) != 0)
+		return true;
+	for (int level = 1; level < WHEEL_LEVELS; level++) {
+		int upper = (tick >> (WHEEL_BITS * level)) & WHEEL_MASK;
+		if (!list_empty (&wheel[level][upper]))
+			return false;
+		if (upper != 0)
+			break;
+	}
+	return true;
+}
+
+/* Returns the number of ticks from now until the first tick at
+   which a timer event may fire, or LIMIT if there is none
+   before then.  Events above level 0 cannot fire until they are
+   cascaded, so only level 0 and the cascade points need to be
+   examined. */
+static int64_t
+wheel_ticks_until_next (int64_t limit) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	for (int64_t tick = wheel_base; tick - ticks < limit; tick++)
+		if (!wheel_cascade_empty (tick)
+				|| !list_empty (&wheel[0][tick & WHEEL_MASK]))
+			return tick - ticks;
+	return limit;
+}
+
+/* Fires every pending event that expires at or before NOW. */
+static void
+wheel_run (int64_t now) {
+	while (wheel_base <= now) {
+		int index = wheel_base & WHEEL_MASK;
+		struct list expired;
+
+		/* When level 0 wraps, pull the next slot of each higher
+		   level down, stopping at the first level that did not
+		   wrap itself. */
+		if (index == 0)
+			for (int level = 1; level < WHEEL_LEVELS; level++) {
+				int upper = (wheel_base >> (WHEEL_BITS * level)) & WHEEL_MASK;
+				wheel_cascade (level, upper);
+				if (upper != 0)
+					break;
+			}
+
+		list_init (&expired);
+		if (!list_empty (&wheel[0][index]))
+			list_splice (list_end (&expired), list_begin (&wheel[0][index]),
+					list_end (&wheel[0][index]));
+		wheel_base++;
+
+		while (!list_empty (&expired)) {
+			struct timer_event *event = list_entry (list_pop_front (&expired),
+					struct timer_event, elem);
+			event->pending = false;
+			event->func (event->aux);
+		}
+	}
+}
+
+/* Advances `ticks' by one. */
+static void
+tick_advance (void) {
+	enum intr_level old_level = seqlock_write_begin (&ticks_seq);
+	ticks++;
+	seqlock_write_end (&ticks_seq, old_level);
+}
+
+/* Timer interrupt handler. */
+static void
+timer_interrupt (struct intr_frame *args) {
+	if (hr_one_shot) {
+		if (timer_ns () < hr_tick_due) {
+			/* A one-shot interrupt for an hrtimer, between ticks. */
+			hr_interrupts++;
+			hrtimer_run ();
+			hrtimer_program ();
+			return;
+		}
+
+		/* The tick that was due.  Resume periodic ticks from
+		   here. */
+		hr_one_shot = false;
+		pit_periodic ();
+	}
+
+	tick_advance ();
+	thread_tick ((args->cs & 3) == 3);
+	profile_tick (args);
+	wheel_run (ticks);
+	hrtimer_run ();
+	hrtimer_program ();
 }
 
 /* Sleep for approximately NUM/DENOM seconds. */
@@ -180,18 +711,22 @@ real_time_sleep (int64_t num, int32_t denom) {
 	   1 s / TIMER_FREQ ticks
 	   */
 	int64_t ticks = num * TIMER_FREQ / denom;
+	int64_t ns = num * (NS_PER_SEC / denom);
 
 	ASSERT (intr_get_level () == INTR_ON);
+	ASSERT (NS_PER_SEC % denom == 0);
 	if (ticks > 0) {
 		/* We're waiting for at least one full timer tick.  Use
 		   timer_sleep() because it will yield the CPU to other
 		   processes. */
 		timer_sleep (ticks);
+	} else if (ns >= HRTIMER_SPIN_NS && tsc_hz != 0) {
+		/* Sleep on an hrtimer, which also yields the CPU. */
+		thread_hrsleep (timer_ns () + ns);
 	} else {
-		/* Otherwise, use a busy-wait loop for more accurate
-		   sub-tick timing.  We scale the numerator and denominator
-		   down by 1000 to avoid the possibility of overflow. */
-		ASSERT (denom % 1000 == 0);
-		busy_wait (loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000));
+		/* Too short to be worth two interrupts.  Spin. */
+		int64_t end = timer_ns () + ns;
+		while (timer_ns () < end)
+			barrier ();
 	}
 }
@@ -3,7 +3,7 @@
 #include <debug.h>
 
 #include "filesys/inode.h"
-#include "threads/malloc.h"
+#include "threads/slab.h"
 
 /* An open file. */
 struct file
@@ -13,12 +13,21 @@ struct file
     bool deny_write;     /* Has file_deny_write() been called? */
 };
 
+/* Cache that open files are allocated from. */
+static struct kmem_cache *file_cachep;
+
+/* Initializes the file module. */
+void file_init(void)
+{
+    file_cachep = kmem_cache_create("file", sizeof(struct file), NULL);
+}
+
 /* Opens a file for the given INODE, of which it takes ownership,
  * and returns the new file.  Returns a null pointer if an
  * allocation fails or if INODE is null. */
 struct file *file_open(struct inode *inode)
 {
-    struct file *file = calloc(1, sizeof *file);
+    struct file *file = kmem_cache_alloc(file_cachep);
     if (inode != NULL && file != NULL)
     {
         file->inode = inode;
@@ -29,7 +38,7 @@ struct file *file_open(struct inode *inode)
     else
     {
         inode_close(inode);
-        free(file);
+        kmem_cache_free(file_cachep, file);
         return NULL;
     }
 }
@@ -61,7 +70,7 @@ void file_close(struct file *file)
     {
         file_allow_write(file);
         inode_close(file->inode);
-        free(file);
+        kmem_cache_free(file_cachep, file);
     }
 }
 
@@ -1,18 +1,57 @@
 #ifndef DEVICES_TIMER_H
 #define DEVICES_TIMER_H
 
+#include <list.h>
+#include <rbtree.h>
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
+/* A kernel timer event.  Once armed, FUNC (AUX) is called from
+   the timer interrupt handler on the first tick at which
+   timer_ticks() >= EXPIRES, unless the event is cancelled
+   first.  Since it runs in an external interrupt context, FUNC
+   must not sleep.
+
+   Events are kept in a hierarchical timer wheel, so arming and
+   cancelling are O(1) and each tick costs O(1) plus the number
+   of events that expire, amortized. */
+typedef void timer_event_func (void *aux);
+
+struct timer_event {
+	struct list_elem elem;      /* Element in a timer wheel slot. */
+	int64_t expires;            /* Tick at which to fire. */
+	timer_event_func *func;     /* Function to call. */
+	void *aux;                  /* Argument to FUNC. */
+	bool pending;               /* Armed and not yet fired? */
+};
+
+/* A high-resolution timer.  Once armed, FUNC (AUX) is called
+   from an interrupt handler as soon as timer_ns() >= EXPIRES,
+   unless the timer is cancelled first.  If that is before the
+   next tick, the PIT is reprogrammed to interrupt just then, so
+   the resolution is that of the PIT's input clock, about 1 us,
+   rather than a tick.  Arming and cancelling are O(lg n). */
+struct hrtimer {
+	struct rb_node node;        /* Element in the hrtimer queue. */
+	int64_t expires;            /* timer_ns() at which to fire. */
+	timer_event_func *func;     /* Function to call. */
+	void *aux;                  /* Argument to FUNC. */
+	bool pending;               /* Armed and not yet fired? */
+};
+
 void timer_init (void);
 void timer_calibrate (void);
 
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
 
+int64_t timer_ns (void);
+int64_t timer_cycles_to_ns (uint64_t cycles);
+
 void timer_sleep (int64_t ticks);
 void timer_msleep (int64_t milliseconds);
 void timer_usleep (int64_t microseconds);
@@ -20,4 +59,18 @@ void timer_nsleep (int64_t nanoseconds);
 
 void timer_print_stats (void);
 
+/* Tickless idle mode. */
+extern bool timer_tickless;
+void timer_tickless_enter (void);
+void timer_tickless_exit (void);
+
+void timer_event_init (struct timer_event *, timer_event_func *, void *aux);
+void timer_event_arm (struct timer_event *, int64_t expires);
+bool timer_event_cancel (struct timer_event *);
+bool timer_event_pending (const struct timer_event *);
+
+void hrtimer_init (struct hrtimer *, timer_event_func *, void *aux);
+void hrtimer_arm (struct hrtimer *, int64_t expires);
+bool hrtimer_cancel (struct hrtimer *);
+
 #endif /* devices/timer.h */
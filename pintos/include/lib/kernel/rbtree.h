@@ -0,0 +1,67 @@
+#ifndef __LIB_KERNEL_RBTREE_H
+#define __LIB_KERNEL_RBTREE_H
+
+/* Red-black tree.
+
+   A self-balancing binary search tree: insertion and removal
+   take O(lg n) time, and the minimum element is cached so that
+   finding it takes O(1).
+
+   Like lists and hash tables, the tree is intrusive and does no
+   dynamic allocation.  A structure that may go into a tree must
+   embed a `struct rb_node' member, and rb_entry() converts a
+   pointer to that member back into a pointer to the enclosing
+   structure.  See lib/kernel/list.h for a fuller explanation of
+   this technique.
+
+   Elements that compare equal are allowed.  A newly inserted
+   element is placed after all elements that compare equal to
+   it, so equal elements come out of the tree in FIFO order. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Red-black tree node. */
+struct rb_node {
+    struct rb_node *parent; /* Parent, or null for the root. */
+    struct rb_node *left;   /* Left child, or null. */
+    struct rb_node *right;  /* Right child, or null. */
+    bool red;               /* Red or black? */
+};
+
+/* Converts pointer to rb_node RB_NODE into a pointer to the
+   structure that RB_NODE is embedded inside.  Supply the name
+   of the outer structure STRUCT and the member name MEMBER of
+   the rb_node. */
+#define rb_entry(RB_NODE, STRUCT, MEMBER) \
+    ((STRUCT *) ((uint8_t *) &(RB_NODE)->parent - \
+                 offsetof(STRUCT, MEMBER.parent)))
+
+/* Compares the value of two tree nodes A and B, given auxiliary
+   data AUX.  Returns true if A is less than B, or false if A is
+   greater than or equal to B. */
+typedef bool rb_less_func(const struct rb_node *a, const struct rb_node *b,
+                          void *aux);
+
+/* Red-black tree. */
+struct rb_tree {
+    struct rb_node *root;     /* Root node, or null if empty. */
+    struct rb_node *min;      /* Leftmost node, or null if empty. */
+    size_t cnt;               /* Number of nodes. */
+    rb_less_func *less;       /* Comparison function. */
+    void *aux;                /* Auxiliary data for `less'. */
+};
+
+void rb_init(struct rb_tree *, rb_less_func *, void *aux);
+
+void rb_insert(struct rb_tree *, struct rb_node *);
+void rb_remove(struct rb_tree *, struct rb_node *);
+
+struct rb_node *rb_min(const struct rb_tree *);
+struct rb_node *rb_next(const struct rb_node *);
+
+size_t rb_size(const struct rb_tree *);
+bool rb_empty(const struct rb_tree *);
+
+#endif /* lib/kernel/rbtree.h */
@@ -0,0 +1,28 @@
+#ifndef __LIB_SCHED_STATS_H
+#define __LIB_SCHED_STATS_H
+
+#include <stdint.h>
+
+/* Number of buckets in the wakeup latency histogram. */
+#define SCHED_LATENCY_BUCKETS 32
+
+/* Scheduling statistics of one thread, as returned by the
+   sched_stats() system call.  Times are in CPU timestamp counter
+   cycles, except that the split between user and kernel mode is
+   sampled once per timer tick. */
+struct sched_stats {
+	uint64_t wait_cycles;               /* Time spent ready, not running. */
+	uint64_t run_cycles;                /* Time spent running. */
+	uint64_t user_ticks;                /* Ticks that found it in user mode. */
+	uint64_t kernel_ticks;              /* Ticks that found it in the kernel. */
+	uint64_t voluntary_switches;        /* Switches away to block or yield. */
+	uint64_t involuntary_switches;      /* Switches away when preempted. */
+
+	/* Wakeup-to-run latency histogram.  Bucket I counts wakeups
+	   after which the thread waited [2**I, 2**(I+1)) cycles for
+	   the CPU; the first and last buckets also count shorter and
+	   longer waits, respectively. */
+	uint32_t latency[SCHED_LATENCY_BUCKETS];
+};
+
+#endif /* lib/sched-stats.h */
@@ -36,6 +36,12 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Scheduling statistics. */
+	SYS_SCHED_STATS,            /* Get a process's scheduling statistics. */
+
+	/* High-resolution time. */
+	SYS_CLOCK_GETTIME,          /* Read a clock. */
 };
 
 #endif /* lib/syscall-nr.h */
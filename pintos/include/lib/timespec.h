@@ -0,0 +1,16 @@
+#ifndef __LIB_TIMESPEC_H
+#define __LIB_TIMESPEC_H
+
+#include <stdint.h>
+
+/* Clocks that clock_gettime() can read. */
+#define CLOCK_MONOTONIC 1               /* Time since boot. */
+#define CLOCK_PROCESS_CPUTIME_ID 2      /* CPU time used by the process. */
+
+/* A time, as returned by the clock_gettime() system call. */
+struct timespec {
+	int64_t tv_sec;                     /* Seconds. */
+	long tv_nsec;                       /* Nanoseconds, 0 to 999,999,999. */
+};
+
+#endif /* lib/timespec.h */
@@ -4,6 +4,8 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <sched-stats.h>
+#include <timespec.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -50,6 +52,12 @@ bool isdir (int fd);
 int inumber (int fd);
 int symlink (const char* target, const char* linkpath);
 
+/* Scheduling statistics. */
+int sched_stats (pid_t pid, struct sched_stats *stats);
+
+/* High-resolution time. */
+int clock_gettime (int clock_id, struct timespec *ts);
+
 static inline void* get_phys_addr (void *user_addr) {
 	void* pa;
 	asm volatile ("movq %0, %%rax" ::"r"(user_addr));
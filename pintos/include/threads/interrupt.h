@@ -15,6 +15,12 @@ enum intr_level intr_set_level (enum intr_level);
 enum intr_level intr_enable (void);
 enum intr_level intr_disable (void);
 
+/* -irqsoff: Track how long interrupts stay off, and where. */
+extern bool intr_irqsoff;
+void intr_irqsoff_sti (void);
+uint64_t intr_irqsoff_longest (const void **off_site, const void **on_site);
+void intr_print_stats (void);
+
 /* Interrupt stack frame. */
 struct gp_registers {
 	uint64_t r15;
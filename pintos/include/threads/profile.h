@@ -0,0 +1,15 @@
+#ifndef THREADS_PROFILE_H
+#define THREADS_PROFILE_H
+
+#include <stddef.h>
+#include "threads/interrupt.h"
+
+/* -prof=N: Sample the running code every N timer ticks, or never
+   if 0. */
+extern unsigned profile_interval;
+
+void profile_tick (const struct intr_frame *);
+void profile_print_stats (void);
+size_t profile_sample_cnt (const char *name);
+
+#endif /* threads/profile.h */
@@ -0,0 +1,24 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <stddef.h>
+
+/* Slab allocator for fixed-size kernel objects.  See slab.c. */
+
+/* Object constructor.  Called on each object once, when the slab
+   that holds it is created, rather than on every allocation. */
+typedef void kmem_ctor_func (void *obj);
+
+struct kmem_cache;
+
+struct kmem_cache *kmem_cache_create (const char *name, size_t size,
+		kmem_ctor_func *ctor);
+void *kmem_cache_alloc (struct kmem_cache *);
+void *kmem_cache_zalloc (struct kmem_cache *);
+void kmem_cache_free (struct kmem_cache *, void *obj);
+size_t kmem_cache_shrink (struct kmem_cache *);
+size_t kmem_cache_pages (struct kmem_cache *);
+
+void kmem_print_stats (void);
+
+#endif /* threads/slab.h */
@@ -0,0 +1,29 @@
+#ifndef THREADS_SWITCH_H
+#define THREADS_SWITCH_H
+
+#include <stdint.h>
+
+/* switch_threads()'s stack frame: the callee-saved registers it
+ * pushes, then the return address pushed by the call. */
+struct switch_threads_frame {
+	uint64_t r15;                       /*  0: Saved %r15. */
+	uint64_t r14;                       /*  8: Saved %r14. */
+	uint64_t r13;                       /* 16: Saved %r13. */
+	uint64_t r12;                       /* 24: Saved %r12. */
+	uint64_t rbp;                       /* 32: Saved %rbp. */
+	uint64_t rbx;                       /* 40: Saved %rbx. */
+	void (*rip) (void);                 /* 48: Return address. */
+};
+
+/* Saves the callee-saved registers on the current stack, stores
+ * the stack pointer in *CUR_RSP, switches to the stack at
+ * NEXT_RSP, and restores the registers saved there.  Returns on
+ * the new stack, into whatever called switch_threads() on it. */
+void switch_threads (uint64_t *cur_rsp, uint64_t next_rsp);
+
+/* Where a new thread's first switch_threads() returns to.  Its
+ * frame's r12 must point to the thread's `struct intr_frame',
+ * which is then loaded with do_iret(). */
+void switch_entry (void);
+
+#endif /* threads/switch.h */
@@ -2,15 +2,61 @@
 #define THREADS_SYNCH_H
 
 #include <list.h>
+#include <rbtree.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include "threads/interrupt.h"
+
+/* Contention statistics shared by every lock or semaphore that
+   is initialized at one place in the source.  Kept only when the
+   kernel is booted with -lockprof.  Times are in TSC cycles. */
+struct sync_site {
+	const char *file;           /* Source file of the init call. */
+	int line;                   /* Source line of the init call. */
+	bool is_lock;               /* Lock, or plain semaphore? */
+	bool registered;            /* On the list of sites yet? */
+	struct sync_site *next;     /* Next registered site. */
+	uint64_t acquires;          /* Successful downs or acquires. */
+	uint64_t contended;         /* Acquires that had to wait. */
+	uint64_t wait_cycles;       /* Total time spent waiting. */
+	uint64_t max_wait_cycles;   /* Longest single wait. */
+	uint64_t hold_cycles;       /* Total time held (locks only). */
+};
+
+/* -lockprof: Profile lock and semaphore contention? */
+extern bool lock_profile;
+
+struct thread;
+
+/* A queue of blocked threads, highest priority first and FIFO
+   among threads of equal priority.  A thread is in at most one
+   wait queue at a time, and is re-queued there if its priority
+   changes while it waits. */
+struct wait_queue {
+	struct rb_tree threads;     /* Threads, ordered by priority. */
+};
+
+void wait_queue_init (struct wait_queue *);
+bool wait_queue_empty (const struct wait_queue *);
+void wait_queue_push (struct wait_queue *, struct thread *);
+struct thread *wait_queue_pop (struct wait_queue *);
+void wait_queue_remove (struct thread *);
 
 /* A counting semaphore. */
 struct semaphore {
 	unsigned value;             /* Current value. */
-	struct list waiters;        /* List of waiting threads. */
+	struct wait_queue waiters;  /* Waiting threads. */
+	struct sync_site *site;     /* Profiling site, or null. */
 };
 
-void sema_init (struct semaphore *, unsigned value);
+/* Initializes SEMA to VALUE, attributing its contention to the
+   caller's source location. */
+#define sema_init(SEMA, VALUE)                                        \
+	({ static struct sync_site sync_site_ =                       \
+	     {.file = __FILE__, .line = __LINE__};                    \
+	   sema_init_at (SEMA, VALUE, &sync_site_); })
+
+void sema_init_at (struct semaphore *, unsigned value, struct sync_site *);
 void sema_down (struct semaphore *);
 bool sema_try_down (struct semaphore *);
 void sema_up (struct semaphore *);
@@ -20,17 +66,33 @@ void sema_self_test (void);
 struct lock {
 	struct thread *holder;      /* Thread holding lock (for debugging). */
 	struct semaphore semaphore; /* Binary semaphore controlling access. */
+	uint64_t acquired_at;       /* When acquired, if profiled. */
+
+	/* Priority donation. */
+	struct rb_tree donors;      /* Waiting threads, highest priority first. */
+	int donation;               /* Top donor's priority, or -1 if none. */
+	struct rb_node held_node;   /* Element in holder's held_locks. */
 };
 
-void lock_init (struct lock *);
+/* Initializes LOCK, attributing its contention to the caller's
+   source location. */
+#define lock_init(LOCK)                                               \
+	({ static struct sync_site sync_site_ =                       \
+	     {.file = __FILE__, .line = __LINE__, .is_lock = true};   \
+	   lock_init_at (LOCK, &sync_site_); })
+
+void lock_init_at (struct lock *, struct sync_site *);
 void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
+void lock_donation_init (struct thread *);
+void refresh_priority (void);
+void lock_print_stats (void);
 
 /* Condition variable. */
 struct condition {
-	struct list waiters;        /* List of waiting threads. */
+	struct wait_queue waiters;  /* Waiting threads. */
 };
 
 void cond_init (struct condition *);
@@ -38,6 +100,40 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Reader-writer lock. */
+struct rwlock {
+	struct lock lock;           /* Held by the writer, briefly by readers. */
+	unsigned readers;           /* Number of readers inside. */
+	bool writer_waiting;        /* Writer waiting for readers to leave? */
+	struct semaphore drained;   /* Upped when the last reader leaves. */
+};
+
+/* Initializes RW, attributing its contention to the caller's
+   source location. */
+#define rwlock_init(RW)                                               \
+	({ static struct sync_site sync_site_ =                       \
+	     {.file = __FILE__, .line = __LINE__, .is_lock = true};   \
+	   rwlock_init_at (RW, &sync_site_); })
+
+void rwlock_init_at (struct rwlock *, struct sync_site *);
+void rwlock_read_acquire (struct rwlock *);
+void rwlock_read_release (struct rwlock *);
+void rwlock_write_acquire (struct rwlock *);
+void rwlock_write_release (struct rwlock *);
+bool rwlock_write_held_by_current_thread (const struct rwlock *);
+
+/* Sequence lock, for small records that are read far more often
+   than they are written. */
+struct seqlock {
+	unsigned seq;               /* Odd while a write is in progress. */
+};
+
+void seqlock_init (struct seqlock *);
+unsigned seqlock_read_begin (const struct seqlock *);
+bool seqlock_read_retry (const struct seqlock *, unsigned start);
+enum intr_level seqlock_write_begin (struct seqlock *);
+void seqlock_write_end (struct seqlock *, enum intr_level);
+
 /* Optimization barrier.
  *
  * The compiler will not reorder operations across an
@@ -3,7 +3,11 @@
 
 #include <debug.h>
 #include <list.h>
+#include <rbtree.h>
+#include <sched-stats.h>
 #include <stdint.h>
+#include "devices/timer.h"
+#include "threads/fixed-point.h"
 #include "threads/synch.h"
 #include "threads/interrupt.h"
 #ifdef VM
@@ -29,6 +33,11 @@ typedef int tid_t;
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
 
+/* Thread niceness, for the multi-level feedback queue scheduler. */
+#define NICE_MIN -20                    /* Most favorable. */
+#define NICE_DEFAULT 0                  /* Default niceness. */
+#define NICE_MAX 20                     /* Least favorable. */
+
 #define FDT_DEFAULT 3
 #define FDCOUNT_LIMIT (FDT_DEFAULT) * (1 << 9)
 
@@ -95,13 +104,44 @@ struct thread {
 	enum thread_status status;          /* Thread state. */
 	char name[16];                      /* Name (for debugging purposes). */
 	int priority;                       /* Priority. */
-	int64_t sleep_ticks;				/* until sleep given ticks*/
-
-	int origin_priority;
-	struct lock * wait_on_lock;
-	
-	struct list donor_list;
-	struct list_elem d_elem;
+	struct list_elem allelem;           /* List element for all threads list. */
+
+	/* Scheduling statistics. */
+	struct sched_stats sched;           /* Counters reported to users. */
+	uint64_t sched_stamp;               /* TSC at last run-state change. */
+	bool sched_woken;                   /* Ready since a wakeup? */
+
+	/* Multi-level feedback queue scheduler state. */
+	int nice;                           /* Niceness. */
+	fixed_t recent_cpu;                 /* Recent CPU use. */
+	int64_t recent_cpu_epoch;           /* Last decay pass applied. */
+
+	/* Completely fair scheduler state. */
+	uint64_t vruntime;                  /* Weighted run time, in ns. */
+	struct rb_node cfs_node;            /* Element in the CFS run queue. */
+
+	/* Real-time (EDF) scheduling state, in timer ticks.  A thread
+	   is in the real-time class iff rt_period is nonzero. */
+	int64_t rt_period;                  /* Time between job releases. */
+	int64_t rt_budget;                  /* Run time allowed per job. */
+	int64_t rt_deadline;                /* Deadline relative to release. */
+	int64_t rt_release;                 /* Current job's release time. */
+	int64_t rt_abs_deadline;            /* Current job's deadline. */
+	int64_t rt_remaining;               /* Budget left for current job. */
+	bool rt_throttled;                  /* Out of budget? */
+	bool rt_overrun;                    /* Current job ran out of budget? */
+	bool rt_parked;                     /* Blocked until next release? */
+	struct timer_event rt_timer;        /* Fires at the next release. */
+	struct rb_node rt_node;             /* Element in the EDF run queue. */
+	long long rt_jobs;                  /* # of jobs completed. */
+	long long rt_misses;                /* # of jobs that missed deadline. */
+	long long rt_throttles;             /* # of times budget ran out. */
+
+	/* Priority donation, owned by synch.c. */
+	int origin_priority;                /* Priority before donations. */
+	struct lock *wait_on_lock;          /* Lock being waited for, if any. */
+	struct rb_node donor_node;          /* Element in wait_on_lock's donors. */
+	struct rb_tree held_locks;          /* Held locks with donors, by donation. */
 	// struct file *fdt[128];         		/* file descriptor table을 배열 포인터로 선언, 사용할 때는 투 포인터를 사용한다*/
 	struct file **fdt;
 	struct file *running_file;
@@ -119,6 +159,8 @@ struct thread {
 
 	/* Shared between thread.c and synch.c. */
 	struct list_elem elem;              /* List element. */
+	struct wait_queue *wait_queue;      /* Wait queue blocked in, if any. */
+	struct rb_node wait_node;           /* Element in wait_queue. */
 
 #ifdef USERPROG
 	/* Owned by userprog/process.c. */
@@ -132,7 +174,8 @@ struct thread {
 #endif
 
 	/* Owned by thread.c. */
-	struct intr_frame tf;               /* Information for switching */
+	struct intr_frame tf;               /* Context for the first run. */
+	uint64_t switch_rsp;                /* Saved rsp while switched out. */
 	unsigned magic;                     /* Detects stack overflow. */
 };
 
@@ -140,14 +183,18 @@ struct thread {
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
+
+/* If true, use the completely fair scheduler instead.
+   Controlled by kernel command-line option "-cfs". */
+extern bool thread_cfs;
 extern bool priority_first (const struct list_elem *a_, const struct list_elem *b_, void *aux UNUSED);
 
-extern int64_t next_to_wake_ticks;
 void thread_init (void);
 void thread_start (void);
 
-void thread_tick (void);
+void thread_tick (bool user);
 void thread_print_stats (void);
+void thread_cache_stats (long long *hits, long long *misses);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
@@ -157,13 +204,30 @@ void thread_unblock (struct thread *);
 
 struct thread *thread_current (void);
 tid_t thread_tid (void);
+tid_t thread_running_tid (void);
 const char *thread_name (void);
 
 void thread_exit (void) NO_RETURN;
 void thread_yield (void);
+void thread_preempt (void);
 
 int thread_get_priority (void);
 void thread_set_priority (int);
+void thread_update_priority (struct thread *, int priority);
+
+/* Real-time statistics for one thread. */
+struct thread_rt_stats {
+	long long jobs;                     /* # of jobs completed. */
+	long long misses;                   /* # of jobs that missed deadline. */
+	long long throttles;                /* # of times budget ran out. */
+};
+
+bool thread_set_realtime (int64_t period, int64_t budget, int64_t deadline);
+void thread_clear_realtime (void);
+void thread_wait_next_period (void);
+void thread_get_rt_stats (struct thread_rt_stats *);
+
+bool thread_get_sched_stats (tid_t, struct sched_stats *);
 
 int thread_get_nice (void);
 void thread_set_nice (int);
@@ -172,8 +236,8 @@ int thread_get_load_avg (void);
 
 void do_iret (struct intr_frame *tf);
 
-void wake_up(int64_t cur_ticks);
-void thread_sleep(int64_t ticks);
+void thread_sleep(int64_t wake_ticks);
+void thread_hrsleep(int64_t wake_ns);
 void yield_to_higher_priority(void);
 
 #endif /* threads/thread.h */
@@ -0,0 +1,44 @@
+#ifndef THREADS_TRACE_H
+#define THREADS_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Tracepoint event identifiers.  An event whose name ends in
+   "_done" closes the most recent unclosed event of the same name
+   without the suffix in the same thread, which lets
+   utils/trace-report compute how long the operation took. */
+enum trace_id
+  {
+    TRACE_SCHED_SWITCH,         /* Context switch. */
+    TRACE_SYSCALL,              /* System call entry. */
+    TRACE_SYSCALL_DONE,         /* System call return. */
+    TRACE_PAGE_FAULT,           /* Page fault handling starts. */
+    TRACE_PAGE_FAULT_DONE,      /* Page fault handling ends. */
+    TRACE_DISK_READ,            /* Disk sector read starts. */
+    TRACE_DISK_READ_DONE,       /* Disk sector read ends. */
+    TRACE_DISK_WRITE,           /* Disk sector write starts. */
+    TRACE_DISK_WRITE_DONE,      /* Disk sector write ends. */
+    TRACE_CNT                   /* Number of event identifiers. */
+  };
+
+/* -trace[=PAGES]: Record tracepoint events into a ring buffer of
+   PAGES pages, or not at all if 0. */
+extern unsigned trace_pages;
+
+/* True while tracepoints are being recorded. */
+extern bool trace_enabled;
+
+/* Records event ID with up to four integer arguments, if tracing
+   is enabled.  Costs one load and branch otherwise. */
+#define TRACE(ID, ...)                                                  \
+        do {                                                            \
+          if (trace_enabled)                                            \
+            trace_emit (ID, (const uint64_t[4]) {__VA_ARGS__});         \
+        } while (0)
+
+void trace_init (void);
+void trace_emit (enum trace_id, const uint64_t args[4]);
+void trace_dump (void);
+
+#endif /* threads/trace.h */
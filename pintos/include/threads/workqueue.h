@@ -0,0 +1,48 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "devices/timer.h"
+
+/* Deferred work.  Once queued, FUNC (AUX) is called by one of a
+   small pool of kernel worker threads, in thread context, so it
+   may sleep, take locks and do I/O.  Work may be queued from an
+   external interrupt handler, which makes the workqueue the way
+   to move anything that may block, or that just takes a while,
+   out of interrupt context or off the path of the thread that
+   triggered it.
+
+   A work item that is already pending is not queued again, so
+   queueing it repeatedly before it runs batches the requests
+   into a single call. */
+typedef void work_func (void *aux);
+
+struct work {
+	struct list_elem elem;      /* Element in the work list. */
+	work_func *func;            /* Function to call. */
+	void *aux;                  /* Argument to FUNC. */
+	bool pending;               /* Queued and not yet started? */
+};
+
+/* Work that is queued after a delay, measured in timer ticks. */
+struct delayed_work {
+	struct work work;           /* The work itself. */
+	struct timer_event timer;   /* Queues WORK when it fires. */
+};
+
+void workqueue_init (void);
+void workqueue_print_stats (void);
+
+void work_init (struct work *, work_func *, void *aux);
+bool queue_work (struct work *);
+bool cancel_work (struct work *);
+
+void delayed_work_init (struct delayed_work *, work_func *, void *aux);
+bool queue_delayed_work (struct delayed_work *, int64_t ticks);
+bool cancel_delayed_work (struct delayed_work *);
+
+void flush_workqueue (void);
+
+#endif /* threads/workqueue.h */
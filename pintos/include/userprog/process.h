@@ -17,12 +17,17 @@ struct lazy_load_data
     size_t page_zero_bytes;
 };
 
+/* Cache that struct lazy_load_data is allocated from. */
+extern struct kmem_cache *lazy_load_cachep;
+
 tid_t process_create_initd(const char *file_name);
 tid_t process_fork(const char *name, struct intr_frame *if_);
 int process_exec(void *f_name);
 int process_wait(tid_t);
 void process_exit(void);
 void process_activate(struct thread *next);
+void process_system_init(void);
+bool process_reap_wait(void);
 bool lazy_load_segment(struct page *page, void *aux);
 
 #endif /* userprog/process.h */
@@ -1,5 +1,6 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
+#include <timespec.h>
 #include "threads/thread.h"
 
 void syscall_init (void);
@@ -19,5 +20,7 @@ bool remove(const char *file);
 struct file *get_file_by_fd(int fd);
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
 void munmap (void *addr);
+int sched_stats (tid_t pid, struct sched_stats *stats);
+int clock_gettime (int clock_id, struct timespec *ts);
 extern struct lock global_lock;
 #endif /* userprog/syscall.h */
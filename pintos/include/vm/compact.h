@@ -0,0 +1,18 @@
+#ifndef VM_COMPACT_H
+#define VM_COMPACT_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "threads/palloc.h"
+
+struct frame;
+
+void vm_compact_init (void);
+void vm_frame_register (struct frame *, uint64_t *pml4);
+void vm_frame_unregister (struct frame *);
+void vm_frame_pin (struct frame *);
+void vm_frame_unpin (struct frame *);
+bool vm_compact (enum palloc_flags, size_t page_cnt);
+void vm_compact_print_stats (void);
+
+#endif
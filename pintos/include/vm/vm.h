@@ -70,7 +70,8 @@ struct page {
 struct frame {
 	void *kva;
 	struct page *page;
-	struct list_elem f_elem;
+	struct list_elem f_elem;   /* 옮길 수 있는 프레임 목록의 원소 */
+	uint64_t *pml4;            /* PAGE를 매핑한 페이지 테이블 */
 };
 
 /* The function table for page operations.
@@ -108,6 +109,7 @@ void supplemental_page_table_init (struct supplemental_page_table *spt);
 bool supplemental_page_table_copy (struct supplemental_page_table *dst,
 		struct supplemental_page_table *src);
 void supplemental_page_table_kill (struct supplemental_page_table *spt);
+void supplemental_page_table_writeback (struct supplemental_page_table *spt);
 struct page *spt_find_page (struct supplemental_page_table *spt,
 		void *va);
 bool spt_insert_page (struct supplemental_page_table *spt, struct page *page);
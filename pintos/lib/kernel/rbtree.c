@@ -0,0 +1,343 @@
+/* Red-black tree.
+
+   See rbtree.h for basic information.  The balancing follows
+   [CLRS] chapter 13, with null pointers in place of the sentinel
+   leaf, so removal has to track the parent of the possibly-null
+   node that replaces the removed one. */
+
+#include "rbtree.h"
+
+#include "../debug.h"
+
+static void change_child(struct rb_tree *, struct rb_node *parent,
+                         struct rb_node *old, struct rb_node *new);
+static void rotate_left(struct rb_tree *, struct rb_node *);
+static void rotate_right(struct rb_tree *, struct rb_node *);
+static void insert_fixup(struct rb_tree *, struct rb_node *);
+static void remove_fixup(struct rb_tree *, struct rb_node *,
+                         struct rb_node *parent);
+
+/* Returns true if NODE is red.  Null leaves are black. */
+static inline bool is_red(const struct rb_node *node)
+{
+    return node != NULL && node->red;
+}
+
+/* Initializes TREE as an empty tree whose nodes are ordered by
+   LESS given auxiliary data AUX. */
+void rb_init(struct rb_tree *tree, rb_less_func *less, void *aux)
+{
+    ASSERT(tree != NULL);
+    ASSERT(less != NULL);
+
+    tree->root = NULL;
+    tree->min = NULL;
+    tree->cnt = 0;
+    tree->less = less;
+    tree->aux = aux;
+}
+
+/* Inserts NODE into TREE, after any nodes that compare equal to
+   it. */
+void rb_insert(struct rb_tree *tree, struct rb_node *node)
+{
+    struct rb_node **link = &tree->root;
+    struct rb_node *parent = NULL;
+    bool leftmost = true;
+
+    ASSERT(tree != NULL);
+    ASSERT(node != NULL);
+
+    while (*link != NULL)
+    {
+        parent = *link;
+        if (tree->less(node, parent, tree->aux))
+            link = &parent->left;
+        else
+        {
+            link = &parent->right;
+            leftmost = false;
+        }
+    }
+
+    node->parent = parent;
+    node->left = node->right = NULL;
+    node->red = true;
+    *link = node;
+
+    if (leftmost) tree->min = node;
+    tree->cnt++;
+
+    insert_fixup(tree, node);
+}
+
+/* Removes NODE from TREE.  Undefined behavior if NODE is not in
+   TREE. */
+void rb_remove(struct rb_tree *tree, struct rb_node *node)
+{
+    struct rb_node *child, *parent;
+    bool removed_red;
+
+    ASSERT(tree != NULL);
+    ASSERT(node != NULL);
+    ASSERT(tree->cnt > 0);
+
+    if (tree->min == node) tree->min = rb_next(node);
+
+    if (node->left == NULL || node->right == NULL)
+    {
+        /* At most one child: splice NODE out. */
+        child = node->left != NULL ? node->left : node->right;
+        parent = node->parent;
+        removed_red = node->red;
+        if (child != NULL) child->parent = parent;
+        change_child(tree, parent, node, child);
+    }
+    else
+    {
+        /* Two children: move NODE's successor, which has no left
+           child, into NODE's place. */
+        struct rb_node *succ = node->right;
+
+        while (succ->left != NULL)
+            succ = succ->left;
+
+        removed_red = succ->red;
+        child = succ->right;
+        if (succ->parent == node)
+            parent = succ;
+        else
+        {
+            parent = succ->parent;
+            if (child != NULL) child->parent = parent;
+            parent->left = child;
+            succ->right = node->right;
+            succ->right->parent = succ;
+        }
+
+        succ->left = node->left;
+        succ->left->parent = succ;
+        succ->parent = node->parent;
+        succ->red = node->red;
+        change_child(tree, node->parent, node, succ);
+    }
+
+    tree->cnt--;
+
+    if (!removed_red) remove_fixup(tree, child, parent);
+}
+
+/* Returns the least node in TREE, or a null pointer if TREE is
+   empty. */
+struct rb_node *rb_min(const struct rb_tree *tree)
+{
+    return tree->min;
+}
+
+/* Returns the node that follows NODE in TREE's order, or a null
+   pointer if NODE is the greatest. */
+struct rb_node *rb_next(const struct rb_node *node)
+{
+    ASSERT(node != NULL);
+
+    if (node->right != NULL)
+    {
+        node = node->right;
+        while (node->left != NULL)
+            node = node->left;
+        return (struct rb_node *) node;
+    }
+
+    while (node->parent != NULL && node == node->parent->right)
+        node = node->parent;
+    return node->parent;
+}
+
+/* Returns the number of nodes in TREE. */
+size_t rb_size(const struct rb_tree *tree)
+{
+    return tree->cnt;
+}
+
+/* Returns true if TREE is empty, false otherwise. */
+bool rb_empty(const struct rb_tree *tree)
+{
+    return tree->root == NULL;
+}
+
+/* Makes NEW take OLD's place as a child of PARENT, or as TREE's
+   root if PARENT is null. */
+static void change_child(struct rb_tree *tree, struct rb_node *parent,
+                         struct rb_node *old, struct rb_node *new)
+{
+    if (parent == NULL)
+        tree->root = new;
+    else if (parent->left == old)
+        parent->left = new;
+    else
+        parent->right = new;
+}
+
+/* Rotates the subtree rooted at NODE to the left, so that NODE's
+   right child takes its place. */
+static void rotate_left(struct rb_tree *tree, struct rb_node *node)
+{
+    struct rb_node *pivot = node->right;
+
+    node->right = pivot->left;
+    if (pivot->left != NULL) pivot->left->parent = node;
+    pivot->parent = node->parent;
+    change_child(tree, node->parent, node, pivot);
+    pivot->left = node;
+    node->parent = pivot;
+}
+
+/* Rotates the subtree rooted at NODE to the right, so that
+   NODE's left child takes its place. */
+static void rotate_right(struct rb_tree *tree, struct rb_node *node)
+{
+    struct rb_node *pivot = node->left;
+
+    node->left = pivot->right;
+    if (pivot->right != NULL) pivot->right->parent = node;
+    pivot->parent = node->parent;
+    change_child(tree, node->parent, node, pivot);
+    pivot->right = node;
+    node->parent = pivot;
+}
+
+/* Restores the red-black properties after red NODE has been
+   inserted into TREE. */
+static void insert_fixup(struct rb_tree *tree, struct rb_node *node)
+{
+    struct rb_node *parent;
+
+    while (is_red(parent = node->parent))
+    {
+        /* A red node is never the root, so PARENT has a parent. */
+        struct rb_node *grandparent = parent->parent;
+
+        if (parent == grandparent->left)
+        {
+            struct rb_node *uncle = grandparent->right;
+
+            if (is_red(uncle))
+            {
+                parent->red = uncle->red = false;
+                grandparent->red = true;
+                node = grandparent;
+                continue;
+            }
+            if (node == parent->right)
+            {
+                rotate_left(tree, parent);
+                node = parent;
+                parent = node->parent;
+            }
+            parent->red = false;
+            grandparent->red = true;
+            rotate_right(tree, grandparent);
+        }
+        else
+        {
+            struct rb_node *uncle = grandparent->left;
+
+            if (is_red(uncle))
+            {
+                parent->red = uncle->red = false;
+                grandparent->red = true;
+                node = grandparent;
+                continue;
+            }
+            if (node == parent->left)
+            {
+                rotate_right(tree, parent);
+                node = parent;
+                parent = node->parent;
+            }
+            parent->red = false;
+            grandparent->red = true;
+            rotate_left(tree, grandparent);
+        }
+    }
+
+    tree->root->red = false;
+}
+
+/* Restores the red-black properties after a black node has been
+   removed from TREE.  NODE, which may be null, took the removed
+   node's place as a child of PARENT and carries an extra
+   black. */
+static void remove_fixup(struct rb_tree *tree, struct rb_node *node,
+                         struct rb_node *parent)
+{
+    while (node != tree->root && !is_red(node))
+    {
+        /* NODE carries an extra black, so its sibling is never a
+           null leaf. */
+        if (node == parent->left)
+        {
+            struct rb_node *sibling = parent->right;
+
+            if (sibling->red)
+            {
+                sibling->red = false;
+                parent->red = true;
+                rotate_left(tree, parent);
+                sibling = parent->right;
+            }
+            if (!is_red(sibling->left) && !is_red(sibling->right))
+            {
+                sibling->red = true;
+                node = parent;
+                parent = node->parent;
+                continue;
+            }
+            if (!is_red(sibling->right))
+            {
+                sibling->left->red = false;
+                sibling->red = true;
+                rotate_right(tree, sibling);
+                sibling = parent->right;
+            }
+            sibling->red = parent->red;
+            parent->red = false;
+            sibling->right->red = false;
+            rotate_left(tree, parent);
+        }
+        else
+        {
+            struct rb_node *sibling = parent->left;
+
+            if (sibling->red)
+            {
+                sibling->red = false;
+                parent->red = true;
+                rotate_right(tree, parent);
+                sibling = parent->left;
+            }
+            if (!is_red(sibling->left) && !is_red(sibling->right))
+            {
+                sibling->red = true;
+                node = parent;
+                parent = node->parent;
+                continue;
+            }
+            if (!is_red(sibling->left))
+            {
+                sibling->right->red = false;
+                sibling->red = true;
+                rotate_left(tree, sibling);
+                sibling = parent->left;
+            }
+            sibling->red = parent->red;
+            parent->red = false;
+            sibling->left->red = false;
+            rotate_right(tree, parent);
+        }
+        node = tree->root;
+        break;
+    }
+
+    if (node != NULL) node->red = false;
+}
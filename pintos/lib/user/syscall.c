@@ -194,3 +194,13 @@ int
 umount (const char *path) {
 	return syscall1 (SYS_UMOUNT, path);
 }
+
+int
+sched_stats (pid_t pid, struct sched_stats *stats) {
+	return syscall2 (SYS_SCHED_STATS, pid, stats);
+}
+
+int
+clock_gettime (int clock_id, struct timespec *ts) {
+	return syscall2 (SYS_CLOCK_GETTIME, clock_id, ts);
+}
@@ -0,0 +1,147 @@
+/* Boots with -cfs and runs groups of CPU-bound threads that all
+   start spinning at the same moment and stop at the same tick,
+   then compares the run time that sched_stats recorded for each.
+
+   First 4 threads with nice 0, 3, 6 and 9 spin for 4 seconds.
+   Each must get between half and twice its share of the CPU by
+   weight, so the shares follow the nice weights and even the
+   lightest thread is not starved.
+
+   Then 2 and 8 threads with nice 0 spin for 2 seconds each.  The
+   time a thread runs between preemptions must be shorter with 8
+   runnable threads than with 2, because the scheduling period is
+   split among more of them. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define MAX_THREAD_CNT 8
+
+struct spinner
+  {
+    int nice;
+    int64_t start;              /* Tick at which to start spinning. */
+    int64_t end;                /* Tick at which to stop spinning. */
+    struct semaphore *done;
+    struct sched_stats stats;   /* Statistics when it stopped. */
+  };
+
+static void run_spinners (struct spinner *, int cnt, const int *nice,
+                          int64_t ticks);
+static uint64_t avg_run (const struct spinner *, int cnt);
+static thread_func spin_thread;
+
+void
+test_cfs_fair (void)
+{
+  /* Weights of nice 0, 3, 6 and 9 in the CFS weight table. */
+  static const int mixed_nice[] = {0, 3, 6, 9};
+  static const uint64_t mixed_weight[] = {1024, 526, 272, 137};
+  static const int zero_nice[MAX_THREAD_CNT];
+  struct spinner s[MAX_THREAD_CNT];
+  uint64_t total, weight_sum, run2, run8;
+  int i;
+
+  if (!thread_cfs)
+    fail ("The completely fair scheduler is not enabled.");
+
+  run_spinners (s, 4, mixed_nice, 4 * TIMER_FREQ);
+  total = weight_sum = 0;
+  for (i = 0; i < 4; i++)
+    {
+      total += s[i].stats.run_cycles;
+      weight_sum += mixed_weight[i];
+    }
+  for (i = 0; i < 4; i++)
+    {
+      /* Compare run_cycles / total with weight / weight_sum. */
+      uint64_t got = s[i].stats.run_cycles * weight_sum;
+      uint64_t fair = total * mixed_weight[i];
+
+      if (got < fair / 2 || got > fair * 2)
+        fail ("Thread with nice %d got %llu of %llu cycles, "
+              "expected about %llu.", mixed_nice[i],
+              s[i].stats.run_cycles, total, fair / weight_sum);
+    }
+  msg ("CPU time followed the nice weights.");
+  msg ("No thread was starved.");
+
+  run_spinners (s, 2, zero_nice, 2 * TIMER_FREQ);
+  run2 = avg_run (s, 2);
+  run_spinners (s, 8, zero_nice, 2 * TIMER_FREQ);
+  run8 = avg_run (s, 8);
+  if (run8 * 3 / 2 > run2)
+    fail ("Threads ran %llu cycles at a time with 2 runnable "
+          "but %llu with 8.", run2, run8);
+  msg ("Slices shrank as more threads became runnable.");
+}
+
+/* Runs CNT spinners, the Ith with nice NICE[I], for TICKS ticks
+   from the same moment, and waits for them to stop. */
+static void
+run_spinners (struct spinner *s, int cnt, const int *nice, int64_t ticks)
+{
+  struct semaphore done;
+  int64_t start;
+  int i;
+
+  ASSERT (cnt <= MAX_THREAD_CNT);
+
+  /* Give every spinner time to set its nice value and go to
+     sleep, so that they all wake up on the same tick. */
+  start = timer_ticks () + TIMER_FREQ / 10;
+  sema_init (&done, 0);
+  for (i = 0; i < cnt; i++)
+    {
+      char name[16];
+
+      s[i].nice = nice[i];
+      s[i].start = start;
+      s[i].end = start + ticks;
+      s[i].done = &done;
+      snprintf (name, sizeof name, "spin %d", i);
+      thread_create (name, PRI_DEFAULT, spin_thread, &s[i]);
+    }
+  for (i = 0; i < cnt; i++)
+    sema_down (&done);
+}
+
+/* Returns the average number of cycles that the CNT spinners in
+   S ran between involuntary switches. */
+static uint64_t
+avg_run (const struct spinner *s, int cnt)
+{
+  uint64_t run = 0, switches = 0;
+  int i;
+
+  for (i = 0; i < cnt; i++)
+    {
+      run += s[i].stats.run_cycles;
+      switches += s[i].stats.involuntary_switches;
+    }
+  if (switches == 0)
+    fail ("%d spinners were never preempted.", cnt);
+  return run / switches;
+}
+
+/* Sets its nice value, sleeps until its start tick, then spins
+   until its end tick and records the statistics of the spin. */
+static void
+spin_thread (void *s_)
+{
+  struct spinner *s = s_;
+  struct sched_stats before;
+
+  thread_set_nice (s->nice);
+  timer_sleep (s->start - timer_ticks ());
+  thread_get_sched_stats (thread_tid (), &before);
+  while (timer_ticks () < s->end)
+    continue;
+  thread_get_sched_stats (thread_tid (), &s->stats);
+  s->stats.run_cycles -= before.run_cycles;
+  s->stats.involuntary_switches -= before.involuntary_switches;
+  sema_up (s->done);
+}
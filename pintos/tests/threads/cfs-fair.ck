@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(cfs-fair) begin
+(cfs-fair) CPU time followed the nice weights.
+(cfs-fair) No thread was starved.
+(cfs-fair) Slices shrank as more threads became runnable.
+(cfs-fair) end
+EOF
+pass;
@@ -0,0 +1,142 @@
+/* Runs a set of periodic real-time threads under EDF while
+   normal threads keep the CPU busy, and reports how many
+   deadlines each real-time thread missed.
+
+   Tasks A and B stay within their budgets and must meet every
+   deadline.  Task C tries to run far past its budget on every
+   job; it should be throttled, and so miss its own deadlines,
+   without making A or B miss theirs.  Admission control must
+   reject a request that would push the set past what EDF can
+   schedule, and accept it once the set has exited. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define HOG_CNT 3
+
+struct rt_task
+  {
+    const char *name;
+    int64_t period, budget, deadline;   /* Real-time parameters. */
+    int64_t work;                       /* Ticks to spin per job. */
+    int jobs;                           /* Number of jobs to run. */
+    bool admitted;
+    struct thread_rt_stats stats;
+    struct semaphore started, done;
+  };
+
+static thread_func rt_thread;
+static thread_func hog_thread;
+
+static volatile bool stop_hogs;
+
+void
+test_edf_deadline (void)
+{
+  static struct rt_task tasks[] =
+    {
+      {.name = "A", .period = 10, .budget = 4, .deadline = 10,
+       .work = 2, .jobs = 20},
+      {.name = "B", .period = 20, .budget = 6, .deadline = 20,
+       .work = 3, .jobs = 10},
+      {.name = "C", .period = 20, .budget = 2, .deadline = 20,
+       .work = 25, .jobs = 5},
+    };
+  struct semaphore hogs_done;
+  struct rt_task *t;
+  int i;
+
+  /* Stay above the hogs, so we can stop them at the end. */
+  thread_set_priority (PRI_MAX);
+
+  sema_init (&hogs_done, 0);
+  stop_hogs = false;
+  for (i = 0; i < HOG_CNT; i++)
+    {
+      char name[16];
+      snprintf (name, sizeof name, "hog %d", i);
+      thread_create (name, PRI_MAX - 1, hog_thread, &hogs_done);
+    }
+
+  for (t = tasks; t < tasks + sizeof tasks / sizeof *tasks; t++)
+    {
+      sema_init (&t->started, 0);
+      sema_init (&t->done, 0);
+      thread_create (t->name, PRI_MAX, rt_thread, t);
+      sema_down (&t->started);
+      if (t->admitted)
+        msg ("Task %s admitted: period %lld, budget %lld, deadline %lld.",
+             t->name, t->period, t->budget, t->deadline);
+      else
+        fail ("Task %s was not admitted.", t->name);
+    }
+
+  /* A, B and C reserve 80% of the CPU, so another 20% is more
+     than admission control allows. */
+  if (thread_set_realtime (10, 2, 10))
+    fail ("Oversubscribing request was admitted.");
+  msg ("Oversubscribing request rejected.");
+
+  for (t = tasks; t < tasks + sizeof tasks / sizeof *tasks; t++)
+    sema_down (&t->done);
+
+  stop_hogs = true;
+  for (i = 0; i < HOG_CNT; i++)
+    sema_down (&hogs_done);
+
+  for (t = tasks; t < tasks + sizeof tasks / sizeof *tasks; t++)
+    if (t->work < t->budget)
+      msg ("Task %s: %lld jobs, %lld deadline misses.",
+           t->name, t->stats.jobs, t->stats.misses);
+    else
+      msg ("Task %s: %lld jobs, %s.", t->name, t->stats.jobs,
+           t->stats.throttles > 0 && t->stats.misses == t->stats.jobs
+           ? "throttled and missed every deadline"
+           : "not throttled as expected");
+
+  if (!thread_set_realtime (10, 2, 10))
+    fail ("Request rejected after the set exited.");
+  thread_clear_realtime ();
+  msg ("Request admitted after the set exited.");
+}
+
+/* Spins for T->work ticks per job, T->jobs times, as a periodic
+   real-time thread. */
+static void
+rt_thread (void *t_)
+{
+  struct rt_task *t = t_;
+  int i;
+
+  t->admitted = thread_set_realtime (t->period, t->budget, t->deadline);
+  sema_up (&t->started);
+  if (!t->admitted)
+    return;
+
+  for (i = 0; i < t->jobs; i++)
+    {
+      int64_t start = timer_ticks ();
+      while (timer_elapsed (start) < t->work)
+        continue;
+      thread_wait_next_period ();
+    }
+
+  thread_get_rt_stats (&t->stats);
+  thread_clear_realtime ();
+  sema_up (&t->done);
+}
+
+/* Keeps the CPU busy until stop_hogs is set. */
+static void
+hog_thread (void *hogs_done_)
+{
+  struct semaphore *hogs_done = hogs_done_;
+
+  while (!stop_hogs)
+    continue;
+  sema_up (hogs_done);
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(edf-deadline) begin
+(edf-deadline) Task A admitted: period 10, budget 4, deadline 10.
+(edf-deadline) Task B admitted: period 20, budget 6, deadline 20.
+(edf-deadline) Task C admitted: period 20, budget 2, deadline 20.
+(edf-deadline) Oversubscribing request rejected.
+(edf-deadline) Task A: 20 jobs, 0 deadline misses.
+(edf-deadline) Task B: 10 jobs, 0 deadline misses.
+(edf-deadline) Task C: 5 jobs, throttled and missed every deadline.
+(edf-deadline) Request admitted after the set exited.
+(edf-deadline) end
+EOF
+pass;
@@ -0,0 +1,78 @@
+/* Sleeps for sub-tick intervals with timer_usleep() while a
+   lower-priority thread spins.  Every sleep must last at least
+   as long as asked, as measured by timer_ns(), and the spinner
+   must get to run during every one of them, which shows that
+   the sleeps block instead of busy-waiting.  Sleeps too short to
+   be worth an interrupt spin, but must not be short either. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define SLEEP_CNT 20
+#define SLEEP_US 500
+#define SPIN_US 5
+
+static thread_func spinner_thread;
+
+static volatile long long spins;
+static volatile bool stop_spinning;
+
+void
+test_hrtimer_sleep (void)
+{
+  struct semaphore done;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&done, 0);
+  stop_spinning = false;
+  thread_create ("spinner", PRI_DEFAULT - 1, spinner_thread, &done);
+
+  for (i = 0; i < SLEEP_CNT; i++)
+    {
+      long long spins_before = spins;
+      int64_t start = timer_ns ();
+      int64_t elapsed;
+
+      timer_usleep (SLEEP_US);
+      elapsed = timer_ns () - start;
+      if (elapsed < SLEEP_US * 1000)
+        fail ("Sleep %d lasted only %lld ns.", i, elapsed);
+      if (spins == spins_before)
+        fail ("Spinner did not run during sleep %d.", i);
+    }
+  msg ("Slept %d times for %d us, each long enough.", SLEEP_CNT, SLEEP_US);
+  msg ("Spinner ran during every sleep.");
+
+  for (i = 0; i < SLEEP_CNT; i++)
+    {
+      int64_t start = timer_ns ();
+      int64_t elapsed;
+
+      timer_usleep (SPIN_US);
+      elapsed = timer_ns () - start;
+      if (elapsed < SPIN_US * 1000)
+        fail ("Short sleep %d lasted only %lld ns.", i, elapsed);
+    }
+  msg ("Slept %d times for %d us, each long enough.", SLEEP_CNT, SPIN_US);
+
+  stop_spinning = true;
+  sema_down (&done);
+}
+
+/* Counts until stop_spinning is set. */
+static void
+spinner_thread (void *done_)
+{
+  struct semaphore *done = done_;
+
+  while (!stop_spinning)
+    spins++;
+  sema_up (done);
+}
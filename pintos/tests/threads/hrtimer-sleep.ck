@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(hrtimer-sleep) begin
+(hrtimer-sleep) Slept 20 times for 500 us, each long enough.
+(hrtimer-sleep) Spinner ran during every sleep.
+(hrtimer-sleep) Slept 20 times for 5 us, each long enough.
+(hrtimer-sleep) end
+EOF
+pass;
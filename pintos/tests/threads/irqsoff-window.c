@@ -0,0 +1,63 @@
+/* Boots with -irqsoff, keeps interrupts off for 20 ms in one
+   function and checks that the latency tracker reports that as
+   the longest window, charged to that function. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/interrupt.h"
+#include "devices/timer.h"
+
+/* How long to keep interrupts off, in milliseconds. */
+#define OFF_MS 20
+
+/* Bytes of code that hold_intr_off() may span. */
+#define HOLD_SIZE 256
+
+static void hold_intr_off (void);
+static bool in_hold (const void *site);
+
+void
+test_irqsoff_window (void)
+{
+  const void *off_site, *on_site;
+  int64_t ns;
+
+  if (!intr_irqsoff)
+    fail ("The interrupts-off tracker is not enabled.");
+
+  hold_intr_off ();
+  msg ("Kept interrupts off for %d ms.", OFF_MS);
+
+  ns = timer_cycles_to_ns (intr_irqsoff_longest (&off_site, &on_site));
+  if (ns < OFF_MS * 1000000LL)
+    fail ("Longest window was %lld ns, less than %d ms.", ns, OFF_MS);
+  if (!in_hold (off_site) || !in_hold (on_site))
+    fail ("Longest window was charged to %p and %p, outside %p.",
+          off_site, on_site, hold_intr_off);
+  msg ("The long window was recorded at its call sites.");
+}
+
+/* Busy-waits for OFF_MS milliseconds with interrupts off. */
+static void NO_INLINE
+hold_intr_off (void)
+{
+  enum intr_level old_level;
+  int64_t end;
+
+  old_level = intr_disable ();
+  end = timer_ns () + OFF_MS * 1000000LL;
+  while (timer_ns () < end)
+    continue;
+  intr_set_level (old_level);
+}
+
+/* Returns true if SITE is a return address inside
+   hold_intr_off(). */
+static bool
+in_hold (const void *site)
+{
+  uintptr_t start = (uintptr_t) hold_intr_off;
+
+  return (uintptr_t) site > start && (uintptr_t) site < start + HOLD_SIZE;
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(irqsoff-window) begin
+(irqsoff-window) Kept interrupts off for 20 ms.
+(irqsoff-window) The long window was recorded at its call sites.
+(irqsoff-window) end
+EOF
+pass;
@@ -0,0 +1,52 @@
+/* Boots with -lockprof, makes a higher-priority thread wait for a
+   lock that this thread holds, and checks that the lock's init
+   site counted both acquires, the wait and the time held. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func waiter_thread;
+
+void
+test_lock_profile (void)
+{
+  struct lock lock;
+  struct sync_site *site;
+
+  if (!lock_profile)
+    fail ("Lock profiling is not enabled.");
+
+  lock_init (&lock);
+  site = lock.semaphore.site;
+  if (site == NULL || !site->registered)
+    fail ("The lock has no profiling site.");
+
+  lock_acquire (&lock);
+  /* The waiter preempts us and blocks on LOCK right away. */
+  thread_create ("waiter", PRI_DEFAULT + 1, waiter_thread, &lock);
+  lock_release (&lock);
+  msg ("The waiter got the lock.");
+
+  if (site->acquires != 2)
+    fail ("Counted %llu acquires instead of 2.", site->acquires);
+  if (site->contended != 1)
+    fail ("Counted %llu contended acquires instead of 1.", site->contended);
+  if (site->wait_cycles == 0 || site->max_wait_cycles != site->wait_cycles)
+    fail ("Wait time %llu (max %llu) is wrong.",
+          site->wait_cycles, site->max_wait_cycles);
+  if (site->hold_cycles == 0)
+    fail ("No time was spent holding the lock.");
+  msg ("The contended lock shows up in the lock profile.");
+}
+
+/* Waits for the lock passed as AUX and releases it. */
+static void
+waiter_thread (void *lock_)
+{
+  struct lock *lock = lock_;
+
+  lock_acquire (lock);
+  lock_release (lock);
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(lock-profile) begin
+(lock-profile) The waiter got the lock.
+(lock-profile) The contended lock shows up in the lock profile.
+(lock-profile) end
+EOF
+pass;
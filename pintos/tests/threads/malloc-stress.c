@@ -0,0 +1,189 @@
+/* Stresses and benchmarks malloc().
+
+   Several threads allocate, check and free blocks of random
+   sizes at the same time, so that they preempt each other in the
+   middle of malloc() and free().  Each block is filled with a
+   pattern that is checked before it is freed or resized, which
+   catches blocks handed out twice or overwritten.
+
+   Then a block is grown one byte at a time with realloc(), which
+   should move it only when it outgrows its size class, and the
+   average TSC cycle count of a malloc()/free() pair is reported
+   for a few sizes.  The cycle counts depend on the machine, so
+   the checker only requires that they be reported. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "intrinsic.h"
+
+#define THREAD_CNT 4
+#define BLOCK_CNT 64
+#define ITERATIONS 20000
+#define BENCH_ROUNDS 10000
+
+struct stress
+  {
+    int id;
+    unsigned seed;
+    int errors;
+    struct semaphore done;
+  };
+
+static thread_func stress_thread;
+static unsigned next_random (unsigned *seed);
+static bool check_block (const unsigned char *p, size_t size, int tag);
+
+void
+test_malloc_stress (void)
+{
+  static const size_t bench_sizes[] = {16, 100, 1000, 3000};
+  struct stress s[THREAD_CNT];
+  char *p, *prev;
+  size_t i;
+  int moves;
+
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      char name[16];
+
+      s[i].id = i;
+      s[i].seed = i + 1;
+      s[i].errors = 0;
+      sema_init (&s[i].done, 0);
+      snprintf (name, sizeof name, "stress %zu", i);
+      thread_create (name, PRI_DEFAULT, stress_thread, &s[i]);
+    }
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      sema_down (&s[i].done);
+      if (s[i].errors != 0)
+        fail ("Thread %zu found %d corrupted blocks.", i, s[i].errors);
+    }
+  msg ("%d threads made %d allocations each without corruption.",
+       THREAD_CNT, ITERATIONS);
+
+  /* Grow a block one byte at a time and count how often realloc()
+     has to move it. */
+  moves = 0;
+  p = malloc (1);
+  p[0] = 0;
+  for (i = 2; i <= 2000; i++)
+    {
+      prev = p;
+      p = realloc (p, i);
+      if (p == NULL)
+        fail ("realloc to %zu bytes failed.", i);
+      if (p != prev)
+        moves++;
+      if (!check_block ((unsigned char *) p, i - 1, 0))
+        fail ("realloc to %zu bytes lost the block's contents.", i);
+      p[i - 1] = (i - 1) & 0xff;
+    }
+  free (p);
+  msg ("Growing a block 1 byte at a time to 2000 bytes moved it %d times.",
+       moves);
+
+  for (i = 0; i < sizeof bench_sizes / sizeof *bench_sizes; i++)
+    {
+      uint64_t start, cycles;
+      int j;
+
+      start = rdtsc ();
+      for (j = 0; j < BENCH_ROUNDS; j++)
+        free (malloc (bench_sizes[i]));
+      cycles = rdtsc () - start;
+      msg ("%zu bytes: %llu cycles per malloc/free pair.",
+           bench_sizes[i], cycles / BENCH_ROUNDS);
+    }
+}
+
+/* Allocates, checks and frees random blocks, counting corrupted
+   blocks in S->errors. */
+static void
+stress_thread (void *s_)
+{
+  struct stress *s = s_;
+  unsigned char *blocks[BLOCK_CNT];
+  size_t sizes[BLOCK_CNT];
+  int i;
+
+  memset (blocks, 0, sizeof blocks);
+  for (i = 0; i < ITERATIONS; i++)
+    {
+      unsigned r = next_random (&s->seed);
+      int slot = r % BLOCK_CNT;
+      size_t size = 1 + (r >> 8) % ((r >> 20) % 8 == 0 ? 6000 : 300);
+      int tag = s->id * BLOCK_CNT + slot;
+
+      if (blocks[slot] != NULL)
+        {
+          if (!check_block (blocks[slot], sizes[slot], tag))
+            s->errors++;
+          if (r & 0x80)
+            {
+              unsigned char *p = realloc (blocks[slot], size);
+              if (p != NULL)
+                {
+                  size_t kept = size < sizes[slot] ? size : sizes[slot];
+                  if (!check_block (p, kept, tag))
+                    s->errors++;
+                  blocks[slot] = p;
+                  sizes[slot] = size;
+                }
+            }
+          else
+            {
+              free (blocks[slot]);
+              blocks[slot] = NULL;
+              continue;
+            }
+        }
+      else
+        {
+          blocks[slot] = malloc (size);
+          if (blocks[slot] == NULL)
+            continue;
+          sizes[slot] = size;
+        }
+
+      /* Fill with the pattern that check_block() expects. */
+      {
+        size_t j;
+        for (j = 0; j < sizes[slot]; j++)
+          blocks[slot][j] = (tag + j) & 0xff;
+      }
+
+      if (i % 64 == 0)
+        thread_yield ();
+    }
+
+  for (i = 0; i < BLOCK_CNT; i++)
+    free (blocks[i]);
+  sema_up (&s->done);
+}
+
+/* Returns the next value of a linear congruential generator. */
+static unsigned
+next_random (unsigned *seed)
+{
+  *seed = *seed * 1103515245 + 12345;
+  return *seed;
+}
+
+/* Returns true if the first SIZE bytes of P hold the pattern for
+   TAG. */
+static bool
+check_block (const unsigned char *p, size_t size, int tag)
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    if (p[i] != ((tag + i) & 0xff))
+      return false;
+  return true;
+}
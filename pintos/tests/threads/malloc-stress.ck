@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+# The cycle counts depend on the machine, so only check that they
+# were reported.
+foreach my $size (16, 100, 1000, 3000) {
+    fail "Cycles for $size-byte blocks were not reported.\n"
+      if !grep (/^\(malloc-stress\) $size bytes: \d+ cycles per malloc\/free pair\.$/, @output);
+}
+@output = grep (!/cycles per malloc\/free pair/, @output);
+
+my (@expected) = ("(malloc-stress) begin",
+		  "(malloc-stress) 4 threads made 20000 allocations each without corruption.",
+		  "(malloc-stress) Growing a block 1 byte at a time to 2000 bytes moved it 23 times.",
+		  "(malloc-stress) end");
+fail "Unexpected output:\n" . join ('', map ("  $_\n", @output))
+  if join ("\n", @output) ne join ("\n", @expected);
+pass;
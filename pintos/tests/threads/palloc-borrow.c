@@ -0,0 +1,88 @@
+/* Checks that the page pools lend each other pages.
+
+   The user pool is used up one page at a time while the kernel
+   pool is left alone, so it must borrow the kernel pool's pages,
+   leaving the kernel pool only its reserve.  Then the same is
+   done the other way around.  Moving pages between the pools
+   must not lose any, so using up the user pool again once
+   everything is freed must yield as many pages as the first
+   time. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+
+/* A page in a list of pages, which links itself through its
+   first word. */
+struct held
+  {
+    struct held *next;
+  };
+
+static size_t exhaust (enum palloc_flags, struct held **list);
+static void release (struct held *list);
+
+void
+test_palloc_borrow (void)
+{
+  struct held *user, *kernel;
+  size_t user_cnt, kernel_cnt, user_cnt2, kernel_cnt2, user_cnt3;
+
+  /* Use up the user pool first. */
+  user_cnt = exhaust (PAL_USER, &user);
+  kernel_cnt = exhaust (0, &kernel);
+  release (user);
+  release (kernel);
+  if (user_cnt <= 2 * kernel_cnt)
+    fail ("User pool got %zu pages, leaving the kernel pool %zu.",
+          user_cnt, kernel_cnt);
+  msg ("The user pool borrowed from the kernel pool.");
+
+  /* Use up the kernel pool first. */
+  kernel_cnt2 = exhaust (0, &kernel);
+  user_cnt2 = exhaust (PAL_USER, &user);
+  release (kernel);
+  release (user);
+  if (kernel_cnt2 <= 2 * user_cnt2)
+    fail ("Kernel pool got %zu pages, leaving the user pool %zu.",
+          kernel_cnt2, user_cnt2);
+  msg ("The kernel pool borrowed from the user pool.");
+
+  /* Nothing may have been lost on the way. */
+  user_cnt3 = exhaust (PAL_USER, &user);
+  release (user);
+  if (user_cnt3 != user_cnt)
+    fail ("User pool got %zu pages the first time but %zu now.",
+          user_cnt, user_cnt3);
+  msg ("No pages were lost moving between the pools.");
+}
+
+/* Allocates pages with FLAGS until there are no more and links
+   them into *LIST.  Returns the number of pages. */
+static size_t
+exhaust (enum palloc_flags flags, struct held **list)
+{
+  size_t cnt = 0;
+  struct held *h;
+
+  *list = NULL;
+  while ((h = palloc_get_page (flags)) != NULL)
+    {
+      h->next = *list;
+      *list = h;
+      cnt++;
+    }
+  return cnt;
+}
+
+/* Frees every page in LIST. */
+static void
+release (struct held *list)
+{
+  while (list != NULL)
+    {
+      struct held *next = list->next;
+      palloc_free_page (list);
+      list = next;
+    }
+}
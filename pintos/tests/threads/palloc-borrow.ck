@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-borrow) begin
+(palloc-borrow) The user pool borrowed from the kernel pool.
+(palloc-borrow) The kernel pool borrowed from the user pool.
+(palloc-borrow) No pages were lost moving between the pools.
+(palloc-borrow) end
+EOF
+pass;
@@ -0,0 +1,248 @@
+/* Checks the buddy page allocator.
+
+   Blocks of random sizes are allocated, which splits bigger free
+   blocks, and each is filled with a pattern.  Then parts of them
+   are freed, from the front or the back, and the holes refilled
+   with new blocks.  Every range handed out must be page aligned,
+   must not overlap any other range still held and must keep its
+   pattern.
+
+   Then the user pool is used up one page at a time and freed
+   again, after which a big block must be available, which only
+   works if the freed pages merged back with their buddies.
+   Finally the user pool is used up with 8-page blocks, every
+   other one is freed, and the holes must take as many 8-page
+   blocks again. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+#define BLOCK_CNT 64
+#define BIG_PAGES 256
+
+/* A range of pages held by the test. */
+struct range
+  {
+    uint8_t *start;
+    size_t page_cnt;
+    int tag;
+  };
+
+/* A block in a list of blocks, which links itself through its
+   first page. */
+struct held
+  {
+    struct held *next;
+  };
+
+static void alloc_range (struct range *, size_t page_cnt, int tag);
+static void check_ranges (const struct range *, size_t cnt);
+static size_t exhaust (size_t page_cnt, int tag, struct held **list);
+static void release (struct held *list, size_t page_cnt);
+static void fill (void *start, size_t page_cnt, int tag);
+static bool check (const void *start, size_t page_cnt, int tag);
+static unsigned next_random (unsigned *seed);
+
+void
+test_palloc_buddy (void)
+{
+  static struct range ranges[BLOCK_CNT];
+  struct held *list, *holes, *refill, **prev, *h;
+  size_t i, freed_cnt, refilled;
+  unsigned seed = 1;
+  void *big;
+
+  for (i = 0; i < BLOCK_CNT; i++)
+    alloc_range (&ranges[i], 1 + next_random (&seed) % 40, i + 1);
+  check_ranges (ranges, BLOCK_CNT);
+  msg ("Allocated %d blocks of 1 to 40 pages.", BLOCK_CNT);
+
+  /* Free the back half of some blocks and the front half of
+     others, and replace the rest with blocks of new sizes. */
+  for (i = 0; i < BLOCK_CNT; i++)
+    {
+      struct range *r = &ranges[i];
+      size_t half = r->page_cnt / 2;
+
+      if (i % 4 == 1)
+        {
+          palloc_free_multiple (r->start + PGSIZE * half, r->page_cnt - half);
+          r->page_cnt = half;
+        }
+      else if (i % 4 == 3)
+        {
+          palloc_free_multiple (r->start, half);
+          r->start += PGSIZE * half;
+          r->page_cnt -= half;
+        }
+      else
+        {
+          palloc_free_multiple (r->start, r->page_cnt);
+          alloc_range (r, 1 + next_random (&seed) % 40, r->tag);
+        }
+    }
+  check_ranges (ranges, BLOCK_CNT);
+  msg ("Freed parts of the blocks and refilled the holes.");
+
+  for (i = 0; i < BLOCK_CNT; i++)
+    palloc_free_multiple (ranges[i].start, ranges[i].page_cnt);
+
+  /* Use up the user pool a page at a time, then free it all. */
+  exhaust (1, 0, &list);
+  release (list, 1);
+  big = palloc_get_multiple (PAL_USER, BIG_PAGES);
+  if (big == NULL)
+    fail ("No %d-page block after freeing the whole user pool.",
+          BIG_PAGES);
+  palloc_free_multiple (big, BIG_PAGES);
+  msg ("Freed pages merged into a %d-page block.", BIG_PAGES);
+
+  /* Use it up with 8-page blocks and free every other one. */
+  exhaust (8, BLOCK_CNT + 1, &list);
+  holes = NULL;
+  freed_cnt = 0;
+  for (prev = &list; *prev != NULL; )
+    {
+      h = *prev;
+      *prev = h->next;
+      h->next = holes;
+      holes = h;
+      freed_cnt++;
+      if (*prev != NULL)
+        prev = &(*prev)->next;
+    }
+  release (holes, 8);
+
+  refilled = exhaust (8, BLOCK_CNT + 2, &refill);
+  if (refilled < freed_cnt)
+    fail ("Freed %zu 8-page blocks but could allocate only %zu again.",
+          freed_cnt, refilled);
+  for (h = list; h != NULL; h = h->next)
+    if (!check (h, 8, BLOCK_CNT + 1))
+      fail ("8-page block at %p was overwritten.", h);
+  for (h = refill; h != NULL; h = h->next)
+    if (!check (h, 8, BLOCK_CNT + 2))
+      fail ("8-page block at %p was overwritten.", h);
+  release (list, 8);
+  release (refill, 8);
+  msg ("Refilled the holes between 8-page blocks.");
+}
+
+/* Allocates PAGE_CNT user pages into R and fills them with TAG's
+   pattern. */
+static void
+alloc_range (struct range *r, size_t page_cnt, int tag)
+{
+  r->start = palloc_get_multiple (PAL_USER, page_cnt);
+  if (r->start == NULL)
+    fail ("Could not allocate %zu pages.", page_cnt);
+  r->page_cnt = page_cnt;
+  r->tag = tag;
+  fill (r->start, page_cnt, tag);
+}
+
+/* Fails unless each of the CNT ranges in RANGES is page aligned,
+   overlaps none of the others and holds its pattern. */
+static void
+check_ranges (const struct range *ranges, size_t cnt)
+{
+  size_t i, j;
+
+  for (i = 0; i < cnt; i++)
+    {
+      const struct range *a = &ranges[i];
+
+      if (pg_ofs (a->start) != 0)
+        fail ("Block %d at %p is not page aligned.", a->tag, a->start);
+      if (!check (a->start, a->page_cnt, a->tag))
+        fail ("Block %d at %p was overwritten.", a->tag, a->start);
+      for (j = i + 1; j < cnt; j++)
+        {
+          const struct range *b = &ranges[j];
+
+          if (a->page_cnt > 0 && b->page_cnt > 0
+              && a->start < b->start + PGSIZE * b->page_cnt
+              && b->start < a->start + PGSIZE * a->page_cnt)
+            fail ("Blocks %d and %d overlap.", a->tag, b->tag);
+        }
+    }
+}
+
+/* Allocates blocks of PAGE_CNT user pages until there are no
+   more, fills them with TAG's pattern and links them into *LIST.
+   Returns the number of blocks. */
+static size_t
+exhaust (size_t page_cnt, int tag, struct held **list)
+{
+  size_t cnt = 0;
+  struct held *h;
+
+  *list = NULL;
+  while ((h = palloc_get_multiple (PAL_USER, page_cnt)) != NULL)
+    {
+      fill (h, page_cnt, tag);
+      h->next = *list;
+      *list = h;
+      cnt++;
+    }
+  return cnt;
+}
+
+/* Frees every block of PAGE_CNT pages in LIST. */
+static void
+release (struct held *list, size_t page_cnt)
+{
+  while (list != NULL)
+    {
+      struct held *next = list->next;
+      palloc_free_multiple (list, page_cnt);
+      list = next;
+    }
+}
+
+/* Fills the PAGE_CNT pages at START, past the first word of
+   each, with a pattern for TAG and each page's number. */
+static void
+fill (void *start, size_t page_cnt, int tag)
+{
+  size_t i;
+
+  for (i = 0; i < page_cnt; i++)
+    {
+      uint8_t *page = (uint8_t *) start + PGSIZE * i;
+      memset (page + sizeof (struct held),
+              (tag * 37 + pg_no (page)) & 0xff,
+              PGSIZE - sizeof (struct held));
+    }
+}
+
+/* Returns true if the PAGE_CNT pages at START hold the pattern
+   that fill() writes for TAG. */
+static bool
+check (const void *start, size_t page_cnt, int tag)
+{
+  size_t i, j;
+
+  for (i = 0; i < page_cnt; i++)
+    {
+      const uint8_t *page = (const uint8_t *) start + PGSIZE * i;
+      uint8_t byte = (tag * 37 + pg_no (page)) & 0xff;
+
+      for (j = sizeof (struct held); j < PGSIZE; j++)
+        if (page[j] != byte)
+          return false;
+    }
+  return true;
+}
+
+/* Returns the next value of a linear congruential generator. */
+static unsigned
+next_random (unsigned *seed)
+{
+  *seed = *seed * 1103515245 + 12345;
+  return *seed;
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-buddy) begin
+(palloc-buddy) Allocated 64 blocks of 1 to 40 pages.
+(palloc-buddy) Freed parts of the blocks and refilled the holes.
+(palloc-buddy) Freed pages merged into a 256-page block.
+(palloc-buddy) Refilled the holes between 8-page blocks.
+(palloc-buddy) end
+EOF
+pass;
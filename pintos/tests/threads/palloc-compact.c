@@ -0,0 +1,112 @@
+/* Checks that palloc_isolate() and palloc_release_isolated()
+   turn scattered free user pages into a block.
+
+   The user pool is used up one page at a time, each page is
+   filled with its number and marked movable, and then every page
+   with an odd page number is freed, so that half of the pool is
+   free but no two free pages are buddies.  An 8-page block is
+   then isolated and the pages in it migrated elsewhere, the way
+   compaction moves user frames, freeing each old page, which the
+   isolated block holds on to.  After that the block must be free
+   and every page must still hold its number. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Pages of pointers to the user pages held by the test. */
+#define PTR_PAGES 16
+#define PTR_CNT (PTR_PAGES * PGSIZE / sizeof (void *))
+
+#define BLOCK_PAGES 8
+
+static bool check (const void *page, size_t n);
+
+void
+test_palloc_compact (void)
+{
+  uint8_t **pages = palloc_get_multiple (PAL_ASSERT, PTR_PAGES);
+  enum intr_level old_level;
+  uint8_t *block, *got;
+  size_t cnt, block_cnt, i;
+
+  /* Use up the user pool and free every other page. */
+  for (cnt = 0; cnt < PTR_CNT; cnt++)
+    {
+      pages[cnt] = palloc_get_page (PAL_USER);
+      if (pages[cnt] == NULL)
+        break;
+      memset (pages[cnt], cnt & 0xff, PGSIZE);
+      palloc_set_movable (pages[cnt], true);
+    }
+  if (cnt == PTR_CNT)
+    fail ("User pool has more than %zu pages.", PTR_CNT);
+  for (i = 0; i < cnt; i++)
+    if (pg_no (pages[i]) % 2 == 1)
+      {
+        palloc_set_movable (pages[i], false);
+        palloc_free_page (pages[i]);
+        pages[i] = NULL;
+      }
+  msg ("Freed every other user page.");
+
+  /* Empty a block by migrating the pages in it. */
+  old_level = intr_disable ();
+  block = palloc_isolate (PAL_USER, BLOCK_PAGES, &block_cnt);
+  if (block == NULL)
+    fail ("Could not isolate a block of %d pages.", BLOCK_PAGES);
+  if (block_cnt != BLOCK_PAGES)
+    fail ("Isolated %zu pages for a %d-page request.",
+          block_cnt, BLOCK_PAGES);
+  for (i = 0; i < cnt; i++)
+    if (pages[i] >= block && pages[i] < block + PGSIZE * block_cnt)
+      {
+        uint8_t *page = palloc_get_page (PAL_USER);
+
+        if (page == NULL)
+          fail ("No free page to migrate to.");
+        if (page >= block && page < block + PGSIZE * block_cnt)
+          fail ("Migrated into the isolated block.");
+        memcpy (page, pages[i], PGSIZE);
+        palloc_set_movable (page, true);
+        palloc_free_page (pages[i]);
+        pages[i] = page;
+      }
+  if (!palloc_release_isolated (block, block_cnt))
+    fail ("Released block %p was not wholly free.", block);
+  got = palloc_get_multiple (PAL_USER, BLOCK_PAGES);
+  intr_set_level (old_level);
+  if (got != block)
+    fail ("Isolated block %p was not free, got %p instead.", block, got);
+  msg ("Migrated the pages out of an 8-page block.");
+
+  for (i = 0; i < cnt; i++)
+    if (pages[i] != NULL && !check (pages[i], i))
+      fail ("Page %zu at %p was not migrated intact.", i, pages[i]);
+  msg ("Every held page kept its contents.");
+
+  palloc_free_multiple (got, BLOCK_PAGES);
+  for (i = 0; i < cnt; i++)
+    if (pages[i] != NULL)
+      {
+        palloc_set_movable (pages[i], false);
+        palloc_free_page (pages[i]);
+      }
+  palloc_free_multiple (pages, PTR_PAGES);
+}
+
+/* Returns true if PAGE holds the number N in every byte. */
+static bool
+check (const void *page, size_t n)
+{
+  const uint8_t *p = page;
+  size_t i;
+
+  for (i = 0; i < PGSIZE; i++)
+    if (p[i] != (n & 0xff))
+      return false;
+  return true;
+}
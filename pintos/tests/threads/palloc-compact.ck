@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-compact) begin
+(palloc-compact) Freed every other user page.
+(palloc-compact) Migrated the pages out of an 8-page block.
+(palloc-compact) Every held page kept its contents.
+(palloc-compact) end
+EOF
+pass;
@@ -0,0 +1,76 @@
+/* Checks that the idle thread zeroes free pages ahead of time and
+   that PAL_ZERO requests are served from them.
+
+   A few user pages are dirtied and freed, and the test sleeps so
+   that the idle thread runs.  Then every PAL_ZERO user page it
+   asks for must come from the zeroed page cache and must really
+   be all zeros, even if it is one of the pages dirtied before. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+#define PAGE_CNT 16
+
+static void get_pages (enum palloc_flags, void *pages[PAGE_CNT]);
+static void free_pages (void *pages[PAGE_CNT]);
+
+void
+test_palloc_zero (void)
+{
+  void *pages[PAGE_CNT];
+  long long hits0, hits;
+  size_t cached;
+  int i;
+
+  get_pages (PAL_USER | PAL_ASSERT, pages);
+  for (i = 0; i < PAGE_CNT; i++)
+    memset (pages[i], 0xcc, PGSIZE);
+  free_pages (pages);
+
+  timer_sleep (TIMER_FREQ / 10);
+  palloc_zero_stats (PAL_USER, &cached, &hits0);
+  if (cached < PAGE_CNT)
+    fail ("Only %zu zeroed pages were cached while idle.", cached);
+  msg ("The idle thread zeroed free pages.");
+
+  get_pages (PAL_USER | PAL_ZERO | PAL_ASSERT, pages);
+  palloc_zero_stats (PAL_USER, &cached, &hits);
+  if (hits - hits0 != PAGE_CNT)
+    fail ("Only %lld of %d PAL_ZERO pages came from the cache.",
+          hits - hits0, PAGE_CNT);
+  for (i = 0; i < PAGE_CNT; i++)
+    {
+      const uint8_t *p = pages[i];
+      size_t ofs;
+
+      for (ofs = 0; ofs < PGSIZE; ofs++)
+        if (p[ofs] != 0)
+          fail ("Page %d has %#x at offset %zu.", i, p[ofs], ofs);
+    }
+  free_pages (pages);
+  msg ("PAL_ZERO pages came from the cache and were zero.");
+}
+
+/* Allocates PAGE_CNT single pages with FLAGS into PAGES. */
+static void
+get_pages (enum palloc_flags flags, void *pages[PAGE_CNT])
+{
+  int i;
+
+  for (i = 0; i < PAGE_CNT; i++)
+    pages[i] = palloc_get_page (flags);
+}
+
+/* Frees the PAGE_CNT pages in PAGES. */
+static void
+free_pages (void *pages[PAGE_CNT])
+{
+  int i;
+
+  for (i = 0; i < PAGE_CNT; i++)
+    palloc_free_page (pages[i]);
+}
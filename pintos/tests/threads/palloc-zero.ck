@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-zero) begin
+(palloc-zero) The idle thread zeroed free pages.
+(palloc-zero) PAL_ZERO pages came from the cache and were zero.
+(palloc-zero) end
+EOF
+pass;
@@ -0,0 +1,48 @@
+/* Boots with -prof, which samples on every timer tick, runs a
+   thread that spins for a second and checks that the profiler
+   took samples while it ran. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/profile.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define SPIN_TICKS TIMER_FREQ
+
+static thread_func spin_thread;
+
+void
+test_profile_samples (void)
+{
+  struct semaphore done;
+  size_t cnt;
+
+  if (profile_interval != 1)
+    fail ("The profiler is not sampling every tick.");
+
+  sema_init (&done, 0);
+  thread_create ("prof-spin", PRI_DEFAULT, spin_thread, &done);
+  sema_down (&done);
+  msg ("Spun for %d ticks.", SPIN_TICKS);
+
+  /* Nothing else runs while the spinner does, but allow for ticks
+     spent starting it up and in other threads. */
+  cnt = profile_sample_cnt ("prof-spin");
+  if (cnt < SPIN_TICKS / 2)
+    fail ("Only %zu samples in %d ticks of spinning.", cnt, SPIN_TICKS);
+  msg ("The profiler recorded samples.");
+}
+
+/* Spins for SPIN_TICKS ticks, then ups the semaphore in AUX. */
+static void
+spin_thread (void *done_)
+{
+  struct semaphore *done = done_;
+  int64_t end = timer_ticks () + SPIN_TICKS;
+
+  while (timer_ticks () < end)
+    continue;
+  sema_up (done);
+}
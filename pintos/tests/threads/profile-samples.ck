@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(profile-samples) begin
+(profile-samples) Spun for 100 ticks.
+(profile-samples) The profiler recorded samples.
+(profile-samples) end
+EOF
+pass;
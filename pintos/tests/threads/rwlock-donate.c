@@ -0,0 +1,61 @@
+/* The main thread holds a reader-writer lock for writing.  Then
+   it creates a higher-priority reader and a still higher-priority
+   writer that block acquiring the lock, donating their priorities
+   to the main thread.  When the main thread releases the lock,
+   the writer and then the reader should get it. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func reader_thread;
+static thread_func writer_thread;
+
+void
+test_rwlock_donate (void)
+{
+  struct rwlock rw;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rw);
+  rwlock_write_acquire (&rw);
+  thread_create ("reader", PRI_DEFAULT + 1, reader_thread, &rw);
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 1, thread_get_priority ());
+  thread_create ("writer", PRI_DEFAULT + 2, writer_thread, &rw);
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 2, thread_get_priority ());
+  rwlock_write_release (&rw);
+  msg ("writer, reader must already have finished, in that order.");
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT, thread_get_priority ());
+}
+
+static void
+reader_thread (void *rw_)
+{
+  struct rwlock *rw = rw_;
+
+  rwlock_read_acquire (rw);
+  msg ("reader: got the read lock");
+  rwlock_read_release (rw);
+  msg ("reader: done");
+}
+
+static void
+writer_thread (void *rw_)
+{
+  struct rwlock *rw = rw_;
+
+  rwlock_write_acquire (rw);
+  msg ("writer: got the write lock");
+  rwlock_write_release (rw);
+  msg ("writer: done");
+}
@@ -0,0 +1,88 @@
+/* Checks that readers share a reader-writer lock and that the
+   lock prefers writers.
+
+   The main thread and three higher-priority readers hold the lock
+   for reading at the same time.  A writer then arrives and must
+   wait for all of them to leave.  A reader that arrives after the
+   writer must wait for the writer too, even though the lock is
+   still held only for reading when it arrives. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define READER_CNT 3
+
+static thread_func reader_thread;
+static thread_func writer_thread;
+static thread_func late_reader_thread;
+
+static struct rwlock rw;
+static struct semaphore go;
+static int readers_inside;
+
+void
+test_rwlock_readers (void)
+{
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  rwlock_init (&rw);
+  sema_init (&go, 0);
+
+  rwlock_read_acquire (&rw);
+  readers_inside = 1;
+  for (i = 0; i < READER_CNT; i++)
+    {
+      char name[16];
+      snprintf (name, sizeof name, "reader %d", i);
+      thread_create (name, PRI_DEFAULT + 1, reader_thread, NULL);
+    }
+  thread_create ("writer", PRI_DEFAULT + 1, writer_thread, NULL);
+  thread_create ("late reader", PRI_DEFAULT + 1, late_reader_thread, NULL);
+
+  msg ("Main thread releasing its read lock.");
+  readers_inside--;
+  rwlock_read_release (&rw);
+  for (i = 0; i < READER_CNT; i++)
+    sema_up (&go);
+  msg ("The writer and the late reader must already have finished, "
+       "in that order.");
+}
+
+static void
+reader_thread (void *aux UNUSED)
+{
+  rwlock_read_acquire (&rw);
+  readers_inside++;
+  msg ("%s: got the read lock, %d readers inside.",
+       thread_name (), readers_inside);
+  sema_down (&go);
+  readers_inside--;
+  msg ("%s: done.", thread_name ());
+  rwlock_read_release (&rw);
+}
+
+static void
+writer_thread (void *aux UNUSED)
+{
+  msg ("writer: acquiring the write lock.");
+  rwlock_write_acquire (&rw);
+  msg ("writer: got the write lock, %d readers inside.", readers_inside);
+  rwlock_write_release (&rw);
+  msg ("writer: done.");
+}
+
+static void
+late_reader_thread (void *aux UNUSED)
+{
+  msg ("late reader: acquiring the read lock.");
+  rwlock_read_acquire (&rw);
+  msg ("late reader: got the read lock.");
+  rwlock_read_release (&rw);
+  msg ("late reader: done.");
+}
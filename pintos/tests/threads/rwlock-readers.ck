@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-readers) begin
+(rwlock-readers) reader 0: got the read lock, 2 readers inside.
+(rwlock-readers) reader 1: got the read lock, 3 readers inside.
+(rwlock-readers) reader 2: got the read lock, 4 readers inside.
+(rwlock-readers) writer: acquiring the write lock.
+(rwlock-readers) late reader: acquiring the read lock.
+(rwlock-readers) Main thread releasing its read lock.
+(rwlock-readers) reader 0: done.
+(rwlock-readers) reader 1: done.
+(rwlock-readers) reader 2: done.
+(rwlock-readers) writer: got the write lock, 0 readers inside.
+(rwlock-readers) writer: done.
+(rwlock-readers) late reader: got the read lock.
+(rwlock-readers) late reader: done.
+(rwlock-readers) The writer and the late reader must already have finished, in that order.
+(rwlock-readers) end
+EOF
+pass;
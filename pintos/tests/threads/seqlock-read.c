@@ -0,0 +1,85 @@
+/* A writer thread keeps updating a two-field record under a
+   seqlock while the main thread, at the same priority, keeps
+   reading it.  Timer preemption interleaves the two.  Every
+   snapshot the reader accepts must be consistent, and the reader
+   must see the writer's final value. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define WRITE_CNT 200000
+
+struct record
+  {
+    int64_t value;
+    int64_t negated;            /* Always -value. */
+  };
+
+static thread_func writer_thread;
+
+static struct seqlock seq;
+static struct record rec;
+static volatile bool writer_done;
+
+void
+test_seqlock_read (void)
+{
+  struct record snap;
+  int64_t last = 0;
+  int inconsistent = 0, backwards = 0;
+  unsigned start;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  seqlock_init (&seq);
+  writer_done = false;
+  thread_create ("writer", PRI_DEFAULT, writer_thread, NULL);
+
+  for (;;)
+    {
+      bool done = writer_done;
+
+      do
+        {
+          start = seqlock_read_begin (&seq);
+          snap = rec;
+        }
+      while (seqlock_read_retry (&seq, start));
+
+      if (snap.value + snap.negated != 0)
+        inconsistent++;
+      if (snap.value < last)
+        backwards++;
+      last = snap.value;
+      if (done)
+        break;
+    }
+
+  if (inconsistent > 0)
+    fail ("%d snapshots were inconsistent.", inconsistent);
+  if (backwards > 0)
+    fail ("%d snapshots went backwards.", backwards);
+  msg ("All snapshots were consistent.");
+  if (last != WRITE_CNT)
+    fail ("Reader saw %lld as the final value, not %d.", last, WRITE_CNT);
+  msg ("Reader saw the final value.");
+}
+
+static void
+writer_thread (void *aux UNUSED)
+{
+  int64_t i;
+
+  for (i = 1; i <= WRITE_CNT; i++)
+    {
+      enum intr_level old_level = seqlock_write_begin (&seq);
+      rec.value = i;
+      rec.negated = -i;
+      seqlock_write_end (&seq, old_level);
+    }
+  writer_done = true;
+}
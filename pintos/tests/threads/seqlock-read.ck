@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(seqlock-read) begin
+(seqlock-read) All snapshots were consistent.
+(seqlock-read) Reader saw the final value.
+(seqlock-read) end
+EOF
+pass;
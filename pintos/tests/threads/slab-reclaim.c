@@ -0,0 +1,52 @@
+/* Checks that a slab cache gives its empty slabs back to the page
+   allocator.
+
+   Enough objects to fill several slabs are allocated and then all
+   freed.  As each slab empties, it must go back to palloc, except
+   for the one spare that the cache keeps, and kmem_cache_shrink()
+   must give back that one too.  Allocating again afterward must
+   still work. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/slab.h"
+
+#define OBJ_SIZE 200
+#define OBJ_CNT 100
+
+void
+test_slab_reclaim (void)
+{
+  static void *objs[OBJ_CNT];
+  struct kmem_cache *c = kmem_cache_create ("slab-reclaim", OBJ_SIZE, NULL);
+  size_t pages;
+  int i;
+
+  for (i = 0; i < OBJ_CNT; i++)
+    if ((objs[i] = kmem_cache_alloc (c)) == NULL)
+      fail ("kmem_cache_alloc() failed for object %d.", i);
+  pages = kmem_cache_pages (c);
+  if (pages < 2)
+    fail ("%d objects fit in %zu slab.", OBJ_CNT, pages);
+  msg ("Allocated %d objects in more than one slab.", OBJ_CNT);
+
+  for (i = 0; i < OBJ_CNT; i++)
+    kmem_cache_free (c, objs[i]);
+  pages = kmem_cache_pages (c);
+  if (pages != 1)
+    fail ("Cache kept %zu empty slabs instead of 1.", pages);
+  msg ("Empty slabs went back to palloc but one.");
+
+  pages = kmem_cache_shrink (c);
+  if (pages != 1 || kmem_cache_pages (c) != 0)
+    fail ("Shrinking freed %zu slabs and left %zu.",
+          pages, kmem_cache_pages (c));
+  msg ("Shrinking gave back the last empty slab.");
+
+  objs[0] = kmem_cache_alloc (c);
+  if (objs[0] == NULL || kmem_cache_pages (c) != 1)
+    fail ("Could not allocate again after shrinking.");
+  kmem_cache_free (c, objs[0]);
+  kmem_cache_shrink (c);
+  msg ("Allocating after shrinking made a new slab.");
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(slab-reclaim) begin
+(slab-reclaim) Allocated 100 objects in more than one slab.
+(slab-reclaim) Empty slabs went back to palloc but one.
+(slab-reclaim) Shrinking gave back the last empty slab.
+(slab-reclaim) Allocating after shrinking made a new slab.
+(slab-reclaim) end
+EOF
+pass;
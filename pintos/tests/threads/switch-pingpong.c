@@ -0,0 +1,66 @@
+/* Measures the cost of a thread switch.  Two threads of equal
+   priority pass control back and forth through a pair of
+   semaphores, so that every sema_up() followed by sema_down()
+   switches threads exactly once, and the average TSC cycle count
+   per switch is reported.
+
+   The figure depends on the machine, so the checker only
+   requires that it be reported. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "intrinsic.h"
+
+#define ROUND_TRIPS 10000
+
+struct pingpong
+  {
+    struct semaphore ping;
+    struct semaphore pong;
+  };
+
+static thread_func pong_thread;
+
+void
+test_switch_pingpong (void)
+{
+  struct pingpong pp;
+  uint64_t start, cycles;
+  int i;
+
+  sema_init (&pp.ping, 0);
+  sema_init (&pp.pong, 0);
+  thread_create ("pong", thread_get_priority (), pong_thread, &pp);
+
+  /* Let the pong thread start and block, so that its first run is
+     not counted. */
+  sema_up (&pp.ping);
+  sema_down (&pp.pong);
+
+  start = rdtsc ();
+  for (i = 0; i < ROUND_TRIPS; i++)
+    {
+      sema_up (&pp.ping);
+      sema_down (&pp.pong);
+    }
+  cycles = rdtsc () - start;
+
+  msg ("%d round trips.", ROUND_TRIPS);
+  msg ("%llu cycles per switch.", cycles / (2 * ROUND_TRIPS));
+}
+
+static void
+pong_thread (void *pp_)
+{
+  struct pingpong *pp = pp_;
+  int i;
+
+  for (i = 0; i < ROUND_TRIPS + 1; i++)
+    {
+      sema_down (&pp->ping);
+      sema_up (&pp->pong);
+    }
+}
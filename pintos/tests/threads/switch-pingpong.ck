@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+# The cycle count depends on the machine, so only check that it
+# was reported.
+fail "Cycles per switch were not reported.\n"
+  if !grep (/^\(switch-pingpong\) \d+ cycles per switch\.$/, @output);
+@output = grep (!/cycles per switch/, @output);
+
+my (@expected) = ("(switch-pingpong) begin",
+		  "(switch-pingpong) 10000 round trips.",
+		  "(switch-pingpong) end");
+fail "Unexpected output:\n" . join ('', map ("  $_\n", @output))
+  if join ("\n", @output) ne join ("\n", @expected);
+pass;
@@ -29,6 +29,25 @@ static const struct test tests[] =
     {"priority-preempt", test_priority_preempt},
     {"priority-sema", test_priority_sema},
     {"priority-condvar", test_priority_condvar},
+    {"edf-deadline", test_edf_deadline},
+    {"switch-pingpong", test_switch_pingpong},
+    {"rwlock-readers", test_rwlock_readers},
+    {"rwlock-donate", test_rwlock_donate},
+    {"seqlock-read", test_seqlock_read},
+    {"hrtimer-sleep", test_hrtimer_sleep},
+    {"workqueue", test_workqueue},
+    {"palloc-buddy", test_palloc_buddy},
+    {"malloc-stress", test_malloc_stress},
+    {"palloc-borrow", test_palloc_borrow},
+    {"palloc-compact", test_palloc_compact},
+    {"trace-switch", test_trace_switch},
+    {"cfs-fair", test_cfs_fair},
+    {"thread-cache", test_thread_cache},
+  {"lock-profile", test_lock_profile},
+  {"profile-samples", test_profile_samples},
+  {"irqsoff-window", test_irqsoff_window},
+  {"palloc-zero", test_palloc_zero},
+  {"slab-reclaim", test_slab_reclaim},
     {"mlfqs-load-1", test_mlfqs_load_1},
     {"mlfqs-load-60", test_mlfqs_load_60},
     {"mlfqs-load-avg", test_mlfqs_load_avg},
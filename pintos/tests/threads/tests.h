@@ -23,6 +23,25 @@ extern test_func test_priority_fifo;
 extern test_func test_priority_preempt;
 extern test_func test_priority_sema;
 extern test_func test_priority_condvar;
+extern test_func test_edf_deadline;
+extern test_func test_switch_pingpong;
+extern test_func test_rwlock_readers;
+extern test_func test_rwlock_donate;
+extern test_func test_seqlock_read;
+extern test_func test_hrtimer_sleep;
+extern test_func test_workqueue;
+extern test_func test_palloc_buddy;
+extern test_func test_malloc_stress;
+extern test_func test_palloc_borrow;
+extern test_func test_palloc_compact;
+extern test_func test_trace_switch;
+extern test_func test_cfs_fair;
+extern test_func test_thread_cache;
+extern test_func test_lock_profile;
+extern test_func test_profile_samples;
+extern test_func test_irqsoff_window;
+extern test_func test_palloc_zero;
+extern test_func test_slab_reclaim;
 extern test_func test_mlfqs_load_1;
 extern test_func test_mlfqs_load_60;
 extern test_func test_mlfqs_load_avg;
@@ -0,0 +1,72 @@
+/* Creates short-lived threads one after another, each of which
+   exits before the next is created, and checks that most of them
+   get their page from the free-thread cache, where the page of a
+   thread that died earlier is kept, instead of from palloc.
+   Each thread also fills part of its stack and checks it, so a
+   recycled page must still work as a stack. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define THREAD_CNT 50
+
+struct worker
+  {
+    int id;
+    bool ok;
+    struct semaphore done;
+  };
+
+static thread_func worker_thread;
+
+void
+test_thread_cache (void)
+{
+  long long hits0, misses0, hits, misses;
+  struct worker w;
+  int i;
+
+  thread_cache_stats (&hits0, &misses0);
+  sema_init (&w.done, 0);
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      w.id = i;
+      w.ok = false;
+      if (thread_create ("worker", PRI_DEFAULT, worker_thread, &w)
+          == TID_ERROR)
+        fail ("thread_create() failed for thread %d.", i);
+      sema_down (&w.done);
+      if (!w.ok)
+        fail ("Thread %d found its stack corrupted.", i);
+    }
+  thread_cache_stats (&hits, &misses);
+  msg ("Created and reaped %d threads.", THREAD_CNT);
+
+  if (hits - hits0 < THREAD_CNT / 2)
+    fail ("Only %lld of %d thread pages came from the cache.",
+          hits - hits0, THREAD_CNT);
+  if (hits + misses - hits0 - misses0 != THREAD_CNT)
+    fail ("Counted %lld cache lookups for %d threads.",
+          hits + misses - hits0 - misses0, THREAD_CNT);
+  msg ("Most thread pages came from the cache.");
+}
+
+/* Fills a buffer on its stack with a pattern, checks it and
+   reports back. */
+static void
+worker_thread (void *w_)
+{
+  struct worker *w = w_;
+  char buf[1024];
+  size_t i;
+
+  memset (buf, w->id, sizeof buf);
+  w->ok = true;
+  for (i = 0; i < sizeof buf; i++)
+    if (buf[i] != (char) w->id)
+      w->ok = false;
+  sema_up (&w->done);
+}
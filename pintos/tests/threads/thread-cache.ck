@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(thread-cache) begin
+(thread-cache) Created and reaped 50 threads.
+(thread-cache) Most thread pages came from the cache.
+(thread-cache) end
+EOF
+pass;
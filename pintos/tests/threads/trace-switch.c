@@ -0,0 +1,65 @@
+/* Boots with -trace and switches threads back and forth through
+   a pair of semaphores, so that schedule() records a context
+   switch event each time the running thread blocks, and once
+   more when the other thread dies.
+
+   The checker makes sure the kernel survived that, and that every
+   context switch event was recorded under the tid of the thread
+   that was switched away from. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/trace.h"
+
+#define ROUND_TRIPS 100
+
+struct pingpong
+  {
+    struct semaphore ping;
+    struct semaphore pong;
+  };
+
+static thread_func pong_thread;
+
+void
+test_trace_switch (void)
+{
+  struct pingpong pp;
+  int i;
+
+  if (!trace_enabled)
+    fail ("Tracing is not enabled.");
+
+  sema_init (&pp.ping, 0);
+  sema_init (&pp.pong, 0);
+  thread_create ("pong", thread_get_priority (), pong_thread, &pp);
+
+  for (i = 0; i < ROUND_TRIPS; i++)
+    {
+      sema_up (&pp.ping);
+      sema_down (&pp.pong);
+    }
+
+  /* Let the pong thread run to its exit. */
+  sema_up (&pp.ping);
+  sema_down (&pp.pong);
+
+  msg ("%d round trips.", ROUND_TRIPS);
+}
+
+/* Answers each ping with a pong, ROUND_TRIPS + 1 times. */
+static void
+pong_thread (void *pp_)
+{
+  struct pingpong *pp = pp_;
+  int i;
+
+  for (i = 0; i <= ROUND_TRIPS; i++)
+    {
+      sema_down (&pp->ping);
+      sema_up (&pp->pong);
+    }
+}
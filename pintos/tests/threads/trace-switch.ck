@@ -0,0 +1,29 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# trace_dump() prints the ring after the test, at power off.  Event
+# 0 is the context switch, whose first argument is the tid of the
+# thread switched away from, that is, the running thread.
+my ($switches) = 0;
+foreach (@output) {
+    next if !/^Trace: -?\d+ (\d+) 0 (\S+) /;
+    my ($tid, $prev) = ($1, hex ($2));
+    fail "Context switch away from tid $prev recorded as tid $tid.\n"
+      if $tid != $prev;
+    $switches++;
+}
+fail "Only $switches context switches were traced.\n"
+  if $switches < 200;
+
+check_expected ([<<'EOF']);
+(trace-switch) begin
+(trace-switch) 100 round trips.
+(trace-switch) end
+EOF
+pass;
@@ -0,0 +1,135 @@
+/* Exercises the workqueue: work queued from an interrupt
+   handler runs on a worker thread, work queued again while
+   pending runs only once, delayed work waits for its delay,
+   cancelled work never runs, and flush_workqueue() waits for
+   everything that was queued. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+#include "devices/timer.h"
+
+#define FLUSH_CNT 10
+
+struct job
+  {
+    struct delayed_work dwork;
+    struct semaphore done;
+    int run_cnt;                /* Times run. */
+    bool on_worker;             /* Ran in a worker thread? */
+    int64_t ran_at;             /* timer_ticks() when last run. */
+  };
+
+static work_func job_func;
+static work_func slow_func;
+static timer_event_func queue_from_interrupt;
+
+static void job_init (struct job *);
+
+void
+test_workqueue (void)
+{
+  static struct job jobs[FLUSH_CNT];
+  struct timer_event event;
+  struct job job;
+  int64_t start;
+  bool again;
+  int slow_done;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Stay above the workers, so they run only when we block. */
+  thread_set_priority (PRI_DEFAULT + 1);
+
+  /* Queue from an interrupt handler. */
+  job_init (&job);
+  timer_event_init (&event, queue_from_interrupt, &job.dwork.work);
+  timer_event_arm (&event, timer_ticks () + 1);
+  sema_down (&job.done);
+  msg ("Work queued from an interrupt ran %s.",
+       job.on_worker ? "on a worker thread" : "elsewhere");
+
+  /* Queue the same work three times before it can run. */
+  job_init (&job);
+  queue_work (&job.dwork.work);
+  again = queue_work (&job.dwork.work) || queue_work (&job.dwork.work);
+  flush_workqueue ();
+  msg ("Work queued 3 times while pending ran %d time(s)%s.",
+       job.run_cnt, again ? ", but was queued again" : "");
+
+  /* Delayed work. */
+  job_init (&job);
+  start = timer_ticks ();
+  queue_delayed_work (&job.dwork, 5);
+  sema_down (&job.done);
+  msg ("Work delayed by 5 ticks ran %s.",
+       job.ran_at - start >= 5 ? "after its delay" : "too early");
+
+  /* Cancelled delayed work. */
+  job_init (&job);
+  queue_delayed_work (&job.dwork, 5);
+  if (!cancel_delayed_work (&job.dwork))
+    fail ("Cancelling pending delayed work failed.");
+  timer_sleep (10);
+  msg ("Cancelled work ran %d time(s).", job.run_cnt);
+
+  /* Flush. */
+  for (i = 0; i < FLUSH_CNT; i++)
+    {
+      job_init (&jobs[i]);
+      work_init (&jobs[i].dwork.work, slow_func, &jobs[i]);
+      queue_work (&jobs[i].dwork.work);
+    }
+  flush_workqueue ();
+  slow_done = 0;
+  for (i = 0; i < FLUSH_CNT; i++)
+    slow_done += jobs[i].run_cnt;
+  msg ("Flush returned after %d of %d slow work items.",
+       slow_done, FLUSH_CNT);
+}
+
+/* Prepares JOB to run job_func(). */
+static void
+job_init (struct job *job)
+{
+  memset (job, 0, sizeof *job);
+  delayed_work_init (&job->dwork, job_func, job);
+  sema_init (&job->done, 0);
+}
+
+/* Records that JOB_ ran, and where. */
+static void
+job_func (void *job_)
+{
+  struct job *job = job_;
+
+  job->run_cnt++;
+  job->on_worker = !intr_context ()
+                   && !memcmp (thread_name (), "kworker/", 8);
+  job->ran_at = timer_ticks ();
+  sema_up (&job->done);
+}
+
+/* Sleeps a little, then records that JOB_ ran. */
+static void
+slow_func (void *job_)
+{
+  struct job *job = job_;
+
+  timer_msleep (10);
+  job->run_cnt++;
+}
+
+/* Timer event function that queues WORK_. */
+static void
+queue_from_interrupt (void *work_)
+{
+  queue_work (work_);
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(workqueue) begin
+(workqueue) Work queued from an interrupt ran on a worker thread.
+(workqueue) Work queued 3 times while pending ran 1 time(s).
+(workqueue) Work delayed by 5 ticks ran after its delay.
+(workqueue) Cancelled work ran 0 time(s).
+(workqueue) Flush returned after 10 of 10 slow work items.
+(workqueue) end
+EOF
+pass;
@@ -0,0 +1,27 @@
+/* Reads the clocks with clock_gettime() and checks that the
+   values are sane: the monotonic clock never goes backward, the
+   process has used some CPU time, and unknown clocks fail. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  struct timespec a, b;
+
+  CHECK (clock_gettime (CLOCK_MONOTONIC, &a) == 0,
+         "clock_gettime(CLOCK_MONOTONIC)");
+  CHECK (a.tv_nsec >= 0 && a.tv_nsec < 1000000000,
+         "nanoseconds are in range");
+  CHECK (clock_gettime (CLOCK_MONOTONIC, &b) == 0,
+         "clock_gettime(CLOCK_MONOTONIC) again");
+  CHECK (b.tv_sec > a.tv_sec
+         || (b.tv_sec == a.tv_sec && b.tv_nsec >= a.tv_nsec),
+         "clock did not go backward");
+  CHECK (clock_gettime (CLOCK_PROCESS_CPUTIME_ID, &a) == 0,
+         "clock_gettime(CLOCK_PROCESS_CPUTIME_ID)");
+  CHECK (a.tv_sec > 0 || a.tv_nsec > 0, "CPU time is nonzero");
+  CHECK (clock_gettime (99, &a) == -1, "clock_gettime(99) fails");
+}
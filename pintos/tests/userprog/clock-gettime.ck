@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(clock-gettime) begin
+(clock-gettime) clock_gettime(CLOCK_MONOTONIC)
+(clock-gettime) nanoseconds are in range
+(clock-gettime) clock_gettime(CLOCK_MONOTONIC) again
+(clock-gettime) clock did not go backward
+(clock-gettime) clock_gettime(CLOCK_PROCESS_CPUTIME_ID)
+(clock-gettime) CPU time is nonzero
+(clock-gettime) clock_gettime(99) fails
+(clock-gettime) end
+clock-gettime: exit(0)
+EOF
+pass;
@@ -0,0 +1,65 @@
+/* Reads this process's scheduling statistics with sched_stats()
+   and checks that they move the way they should: run time
+   accumulates, spinning while another process is runnable gets
+   preempted, which counts as an involuntary switch only, and
+   blocking in wait() counts as a voluntary switch. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static void spin (int ms);
+
+void
+test_main (void)
+{
+  struct sched_stats before, after;
+  int pid;
+
+  CHECK (sched_stats (0, &before) == 0, "sched_stats(0)");
+  CHECK (before.run_cycles > 0, "run time is nonzero");
+
+  if ((pid = fork ("child")))
+    {
+      struct sched_stats spun;
+
+      /* The child spins for longer than we do, so we compete with
+         it for the CPU the whole time.  The first, short spin
+         faults in anything the loop touches, so that the measured
+         one never blocks. */
+      spin (10);
+      CHECK (sched_stats (0, &spun) == 0, "sched_stats(0) before spinning");
+      spin (200);
+      CHECK (sched_stats (0, &after) == 0, "sched_stats(0) after spinning");
+      CHECK (after.involuntary_switches > spun.involuntary_switches,
+             "spinning was preempted");
+      CHECK (after.voluntary_switches == spun.voluntary_switches,
+             "spinning never gave up the CPU voluntarily");
+
+      wait (pid);
+      CHECK (sched_stats (0, &after) == 0, "sched_stats(0) again");
+      CHECK (after.run_cycles > before.run_cycles, "run time grew");
+      CHECK (after.voluntary_switches > spun.voluntary_switches,
+             "waiting for the child was a voluntary switch");
+      CHECK (sched_stats (-1, &after) == -1, "sched_stats(-1) fails");
+    }
+  else
+    {
+      spin (1000);
+      exit (81);
+    }
+}
+
+/* Busy-waits for MS milliseconds of wall-clock time. */
+static void
+spin (int ms)
+{
+  struct timespec start, now;
+  int64_t end_ns;
+
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  end_ns = start.tv_sec * 1000000000LL + start.tv_nsec + ms * 1000000LL;
+  do
+    clock_gettime (CLOCK_MONOTONIC, &now);
+  while (now.tv_sec * 1000000000LL + now.tv_nsec < end_ns);
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(sched-stats) begin
+(sched-stats) sched_stats(0)
+(sched-stats) run time is nonzero
+(sched-stats) sched_stats(0) before spinning
+(sched-stats) sched_stats(0) after spinning
+(sched-stats) spinning was preempted
+(sched-stats) spinning never gave up the CPU voluntarily
+child: exit(81)
+(sched-stats) sched_stats(0) again
+(sched-stats) run time grew
+(sched-stats) waiting for the child was a voluntary switch
+(sched-stats) sched_stats(-1) fails
+(sched-stats) end
+sched-stats: exit(0)
+EOF
+pass;
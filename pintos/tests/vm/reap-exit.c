@@ -0,0 +1,90 @@
+/* Forks children one after another that each touch CHILD_PAGES
+   pages and exit.  Together they touch several times as many
+   pages as there is memory, so a later child can only get its
+   pages if the address spaces of the earlier ones were freed.
+
+   Each child also records the time just before it exits, and
+   the parent checks that its wait() returned soon after, since
+   an exited process's address space is torn down in the
+   background instead of before its exit status is reported. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHILD_PAGES 1024
+#define CHILD_CNT 8
+#define PAGE_SIZE 4096
+
+/* Longest time allowed from a child's exit to its parent's
+   return from wait(), in nanoseconds. */
+#define MAX_LATENCY_NS (20 * 1000000LL)
+
+static char buf[CHILD_PAGES * PAGE_SIZE];
+
+static int64_t now_ns (void);
+static void child (int id);
+
+void
+test_main (void)
+{
+  int i;
+
+  CHECK (create ("stamp", sizeof (int64_t)), "create \"stamp\"");
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      int64_t stamp, latency;
+      int pid, fd;
+
+      pid = fork ("child");
+      if (pid == 0)
+        child (i);
+      if (pid < 0)
+        fail ("fork() failed for child %d", i);
+      if (wait (pid) != i)
+        fail ("child %d returned the wrong exit status", i);
+      latency = now_ns ();
+
+      if ((fd = open ("stamp")) < 0
+          || read (fd, &stamp, sizeof stamp) != sizeof stamp)
+        fail ("could not read the exit time of child %d", i);
+      close (fd);
+      latency -= stamp;
+      if (latency > MAX_LATENCY_NS)
+        fail ("wait() for child %d took %lld ns after it exited",
+              i, latency);
+    }
+  msg ("%d children touched %d pages each", CHILD_CNT, CHILD_PAGES);
+  msg ("each wait() returned within %lld ms of the exit",
+       MAX_LATENCY_NS / 1000000);
+}
+
+/* Touches every page of BUF, records the time in "stamp" and
+   exits with status ID. */
+static void
+child (int id)
+{
+  int64_t stamp;
+  size_t ofs;
+  int fd;
+
+  for (ofs = 0; ofs < sizeof buf; ofs += PAGE_SIZE)
+    buf[ofs] = id;
+  if ((fd = open ("stamp")) < 0)
+    exit (-1);
+  stamp = now_ns ();
+  write (fd, &stamp, sizeof stamp);
+  close (fd);
+  exit (id);
+}
+
+/* Returns the monotonic clock in nanoseconds. */
+static int64_t
+now_ns (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(reap-exit) begin
+(reap-exit) create "stamp"
+child: exit(0)
+child: exit(1)
+child: exit(2)
+child: exit(3)
+child: exit(4)
+child: exit(5)
+child: exit(6)
+child: exit(7)
+(reap-exit) 8 children touched 1024 pages each
+(reap-exit) each wait() returned within 20 ms of the exit
+(reap-exit) end
+reap-exit: exit(0)
+EOF
+pass;
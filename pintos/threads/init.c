@@ -19,8 +19,13 @@
 #include "threads/malloc.h"
 #include "threads/mmu.h"
 #include "threads/palloc.h"
+#include "threads/profile.h"
 #include "threads/pte.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+#include "threads/workqueue.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -30,6 +35,7 @@
 #endif
 #include "tests/threads/tests.h"
 #ifdef VM
+#include "vm/compact.h"
 #include "vm/vm.h"
 #endif
 #ifdef FILESYS
@@ -86,6 +92,7 @@ main (void) {
 	mem_end = palloc_init ();	//mem_end -> 20MB 우리가 정했던 메모리 크기
 	malloc_init ();
 	paging_init (mem_end);
+	trace_init ();
 
 #ifdef USERPROG
 	tss_init ();
@@ -100,6 +107,7 @@ main (void) {
 #ifdef USERPROG
 	exception_init ();
 	syscall_init ();
+	process_system_init ();
 #endif
 	/* Start thread scheduler and enable interrupts. */
 	thread_start ();
@@ -221,6 +229,26 @@ parse_options (char **argv) {
 			random_init (atoi (value));
 		else if (!strcmp (name, "-mlfqs"))
 			thread_mlfqs = true;
+		else if (!strcmp (name, "-cfs"))
+			thread_cfs = true;
+		else if (!strcmp (name, "-tickless"))
+			timer_tickless = true;
+		else if (!strcmp (name, "-irqsoff"))
+			intr_irqsoff = true;
+		else if (!strcmp (name, "-lockprof"))
+			lock_profile = true;
+		else if (!strcmp (name, "-prof")) {
+			int interval = value != NULL ? atoi (value) : 1;
+			if (interval <= 0)
+				PANIC ("-prof interval must be positive");
+			profile_interval = interval;
+		}
+		else if (!strcmp (name, "-trace")) {
+			int pages = value != NULL ? atoi (value) : 64;
+			if (pages <= 0)
+				PANIC ("-trace size must be positive");
+			trace_pages = pages;
+		}
 #ifdef USERPROG
 		else if (!strcmp (name, "-ul"))
 			user_page_limit = atoi (value);
@@ -231,6 +259,9 @@ parse_options (char **argv) {
 			PANIC ("unknown option `%s' (use -h for help)", name);
 	}
 
+	if (thread_mlfqs && thread_cfs)
+		PANIC ("-mlfqs and -cfs are mutually exclusive");
+
 	return argv;
 }
 
@@ -326,6 +357,12 @@ usage (void) {
 			"  -f                 Format file system disk during startup.\n"
 			"  -rs=SEED           Set random number seed to SEED.\n"
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
+			"  -cfs               Use completely fair scheduler.\n"
+			"  -tickless          Stop the timer tick while idle.\n"
+			"  -irqsoff           Report the longest interrupts-off windows.\n"
+			"  -lockprof          Profile lock and semaphore contention.\n"
+			"  -prof[=N]          Sample the running code every N ticks.\n"
+			"  -trace[=PAGES]     Record tracepoints in a PAGES-page ring.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
@@ -354,6 +391,16 @@ static void
 print_stats (void) {
 	timer_print_stats ();
 	thread_print_stats ();
+	workqueue_print_stats ();
+	lock_print_stats ();
+	intr_print_stats ();
+	profile_print_stats ();
+	trace_dump ();
+	palloc_print_stats ();
+	kmem_print_stats ();
+#ifdef VM
+	vm_compact_print_stats ();
+#endif
 #ifdef FILESYS
 	disk_print_stats ();
 #endif
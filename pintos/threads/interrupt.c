@@ -110,6 +110,12 @@ static void pic_end_of_interrupt (int irq);
 /* Interrupt handlers. */
 void intr_handler (struct intr_frame *args);
 
+/* Interrupts-off latency tracker. */
+static enum intr_level enable_at (const void *site);
+static enum intr_level disable_at (const void *site);
+static void irqsoff_begin (const void *site, const char *intr);
+static void irqsoff_end (const void *site);
+
 /* Returns the current interrupt status. */
 enum intr_level
 intr_get_level (void) {
@@ -128,15 +134,32 @@ intr_get_level (void) {
    returns the previous interrupt status. */
 enum intr_level
 intr_set_level (enum intr_level level) {
-	return level == INTR_ON ? intr_enable () : intr_disable ();
+	const void *site = __builtin_return_address (0);
+	return level == INTR_ON ? enable_at (site) : disable_at (site);
 }
 
 /* Enables interrupts and returns the previous interrupt status. */
 enum intr_level
 intr_enable (void) {
+	return enable_at (__builtin_return_address (0));
+}
+
+/* Disables interrupts and returns the previous interrupt status. */
+enum intr_level
+intr_disable (void) {
+	return disable_at (__builtin_return_address (0));
+}
+
+/* Enables interrupts on behalf of the caller at SITE and returns
+   the previous interrupt status. */
+static enum intr_level
+enable_at (const void *site) {
 	enum intr_level old_level = intr_get_level ();
 	ASSERT (!intr_context ());
 
+	if (intr_irqsoff && old_level == INTR_OFF)
+		irqsoff_end (site);
+
 	/* Enable interrupts by setting the interrupt flag.
 
 	   See [IA32-v2b] "STI" and [IA32-v3a] 5.8.1 "Masking Maskable
@@ -146,9 +169,10 @@ intr_enable (void) {
 	return old_level;
 }
 
-/* Disables interrupts and returns the previous interrupt status. */
-enum intr_level
-intr_disable (void) {
+/* Disables interrupts on behalf of the caller at SITE and
+   returns the previous interrupt status. */
+static enum intr_level
+disable_at (const void *site) {
 	enum intr_level old_level = intr_get_level ();
 
 	/* Disable interrupts by clearing the interrupt flag.
@@ -156,9 +180,170 @@ intr_disable (void) {
 	   Hardware Interrupts". */
 	asm volatile ("cli" : : : "memory");
 
+	if (intr_irqsoff && old_level == INTR_ON)
+		irqsoff_begin (site, NULL);
+
 	return old_level;
 }
 
+/* Interrupts-off latency tracker.
+
+   With -irqsoff, every transition of the interrupt flag that
+   goes through this file is timestamped with the TSC, and each
+   window during which interrupts stayed off is charged to the
+   pair of call sites that turned them off and back on.  An
+   interrupt entered through an interrupt gate also opens a
+   window, named after the interrupt, that the handler closes by
+   enabling interrupts or that ends at the interrupt's return.
+
+   A window may also end in an `sti' or `iret' that does not go
+   through here, such as a new thread's first return from
+   thread_launch().  Such a window is noticed the next time
+   interrupts are seen to be on, and then discarded as
+   unmatched rather than charged with time it did not take. */
+
+/* Number of distinct call site pairs kept. */
+#define IRQSOFF_TOP 10
+
+/* The longest window seen between one pair of call sites. */
+struct irqsoff_window {
+	const void *off_site;       /* Caller that disabled interrupts. */
+	const char *off_intr;       /* Or the interrupt that did. */
+	const void *on_site;        /* Caller that enabled them, or null
+	                               for an interrupt return. */
+	uint64_t max_cycles;        /* Longest window. */
+	long long cnt;              /* Number of windows. */
+};
+
+bool intr_irqsoff;
+
+static struct irqsoff_window irqsoff_top[IRQSOFF_TOP];
+static uint64_t off_since;      /* TSC when the open window began, or 0. */
+static const void *off_site;    /* Who opened it. */
+static const char *off_intr;
+static long long window_cnt;    /* Windows measured. */
+static long long unmatched_cnt; /* Windows discarded. */
+static uint64_t total_cycles;   /* Time spent with interrupts off. */
+
+/* Starts a window with interrupts off, opened by the caller at
+   SITE or, if INTR is nonnull, by that interrupt. */
+static void
+irqsoff_begin (const void *site, const char *intr) {
+	if (off_since != 0)
+		unmatched_cnt++;
+	off_since = rdtsc ();
+	off_site = site;
+	off_intr = intr;
+}
+
+/* Ends the open window, if any, as interrupts are about to be
+   enabled by the caller at SITE or, if SITE is null, by an
+   interrupt return. */
+static void
+irqsoff_end (const void *site) {
+	struct irqsoff_window *w, *shortest;
+	uint64_t cycles;
+
+	if (off_since == 0)
+		return;
+	cycles = rdtsc () - off_since;
+	off_since = 0;
+	window_cnt++;
+	total_cycles += cycles;
+
+	/* Charge the window to its call site pair, or let the pair
+	   displace the one with the shortest maximum. */
+	shortest = irqsoff_top;
+	for (w = irqsoff_top; w < irqsoff_top + IRQSOFF_TOP; w++) {
+		if (w->cnt != 0 && w->off_site == off_site
+		    && w->off_intr == off_intr && w->on_site == site) {
+			w->cnt++;
+			if (cycles > w->max_cycles)
+				w->max_cycles = cycles;
+			return;
+		}
+		if (w->max_cycles < shortest->max_cycles)
+			shortest = w;
+	}
+	if (cycles > shortest->max_cycles)
+		*shortest = (struct irqsoff_window) {
+			.off_site = off_site,
+			.off_intr = off_intr,
+			.on_site = site,
+			.max_cycles = cycles,
+			.cnt = 1,
+		};
+}
+
+/* Tells the interrupts-off latency tracker that the caller is
+   about to enable interrupts with an `sti' of its own, as the
+   idle thread does. */
+void
+intr_irqsoff_sti (void) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (intr_irqsoff)
+		irqsoff_end (__builtin_return_address (0));
+}
+
+/* Returns the length in TSC cycles of the longest window with
+   interrupts off measured so far, and stores the call sites that
+   turned interrupts off and back on in *OFF_SITE and *ON_SITE.
+   Either site is null if an interrupt opened or closed the
+   window, and both are if no window was measured. */
+uint64_t
+intr_irqsoff_longest (const void **off_site, const void **on_site) {
+	struct irqsoff_window longest = {0}, *w;
+	enum intr_level old_level;
+
+	old_level = intr_disable ();
+	for (w = irqsoff_top; w < irqsoff_top + IRQSOFF_TOP; w++)
+		if (w->cnt != 0 && w->max_cycles > longest.max_cycles)
+			longest = *w;
+	intr_set_level (old_level);
+
+	*off_site = longest.off_intr == NULL ? longest.off_site : NULL;
+	*on_site = longest.on_site;
+	return longest.max_cycles;
+}
+
+/* Prints the call sites with the longest windows with
+   interrupts off.  utils/backtrace translates the addresses
+   into functions. */
+void
+intr_print_stats (void) {
+	struct irqsoff_window *w, *v;
+
+	if (!intr_irqsoff)
+		return;
+	intr_irqsoff = false;
+
+	printf ("Interrupts off: %lld windows, %lld ms total, "
+			"%lld unmatched\n", window_cnt,
+			timer_cycles_to_ns (total_cycles) / 1000000, unmatched_cnt);
+
+	/* Sort by maximum, longest first. */
+	for (w = irqsoff_top + 1; w < irqsoff_top + IRQSOFF_TOP; w++)
+		for (v = w; v > irqsoff_top && v[-1].max_cycles < v->max_cycles; v--) {
+			struct irqsoff_window tmp = v[-1];
+			v[-1] = *v;
+			*v = tmp;
+		}
+
+	for (w = irqsoff_top; w < irqsoff_top + IRQSOFF_TOP && w->cnt != 0; w++) {
+		printf ("  %8lld us max, %8lld times: ",
+				timer_cycles_to_ns (w->max_cycles) / 1000, w->cnt);
+		if (w->off_intr != NULL)
+			printf ("off in %s", w->off_intr);
+		else
+			printf ("off at %p", w->off_site);
+		if (w->on_site != NULL)
+			printf (", on at %p\n", w->on_site);
+		else
+			printf (", on at return\n");
+	}
+}
+
 /* Initializes the interrupt system. */
 void
 intr_init (void) {
@@ -340,12 +525,18 @@ intr_handler (struct intr_frame *frame) {
 	   and they need to be acknowledged on the PIC (see below).
 	   An external interrupt handler cannot sleep. */
 	external = frame->vec_no >= 0x20 && frame->vec_no < 0x30;
+	if (intr_irqsoff && (frame->eflags & FLAG_IF)
+	    && intr_get_level () == INTR_OFF)
+		irqsoff_begin (NULL, intr_names[frame->vec_no]);
 	if (external) {
 		ASSERT (intr_get_level () == INTR_OFF);
 		ASSERT (!intr_context ());
 
 		in_external_intr = true;
 		yield_on_return = false;
+
+		/* Bring the clock up to date if we were idling tickless. */
+		timer_tickless_exit ();
 	}
 
 	/* Invoke the interrupt's handler. */
@@ -372,8 +563,13 @@ intr_handler (struct intr_frame *frame) {
 		pic_end_of_interrupt (frame->vec_no);
 
 		if (yield_on_return)
-			thread_yield ();
+			thread_preempt ();
 	}
+
+	/* Returning will turn interrupts back on. */
+	if (intr_irqsoff && (frame->eflags & FLAG_IF)
+	    && intr_get_level () == INTR_OFF)
+		irqsoff_end (NULL);
 }
 
 /* Dumps interrupt frame F to the console, for debugging. */
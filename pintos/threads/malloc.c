@@ -5,16 +5,21 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 
 /* A simple implementation of malloc().
 
-   The size of each request, in bytes, is rounded up to a power
-   of 2 and assigned to the "descriptor" that manages blocks of
-   that size.  The descriptor keeps a list of free blocks.  If
-   the free list is nonempty, one of its blocks is used to
+   The size of each request, in bytes, is rounded up to the
+   nearest size class and assigned to the "descriptor" that
+   manages blocks of that size.  Below 64 bytes the classes are
+   16 bytes apart; above, there are four classes per power of 2,
+   so that no block is more than 25% larger than the request.
+   A table indexed by size, in 16-byte units, gives the class in
+   constant time.  The descriptor keeps a list of free blocks.
+   If the free list is nonempty, one of its blocks is used to
    satisfy the request.
 
    Otherwise, a new page of memory, called an "arena", is
@@ -28,11 +33,29 @@
    blocks, we remove all of the arena's blocks from the free list
    and give the arena back to the page allocator.
 
-   We can't handle blocks bigger than 2 kB using this scheme,
-   because they're too big to fit in a single page with a
+   The free list is protected by a lock.  In front of it, each
+   descriptor has a small "magazine" of free blocks that malloc()
+   and free() reach with interrupts disabled instead, which on a
+   single CPU is all it takes to keep it consistent and is much
+   cheaper than a lock.  malloc() refills an empty magazine, and
+   free() drains a full one, a batch of blocks at a time under
+   the lock.  Blocks in a magazine count as in use, so they keep
+   their arenas allocated; the magazines are small to bound that.
+
+   We can't handle blocks bigger than about 2 kB using this
+   scheme, because two of them don't fit in a single page with a
    descriptor.  We handle those by allocating contiguous pages
    with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   the beginning of the allocated block's arena header.
+
+   realloc() resizes a block in place when the new size falls in
+   the same class, or when a big block shrinks, in which case its
+   tail pages are freed. */
+
+/* Blocks cached in each descriptor's magazine, and how many
+   malloc() and free() move to and from the free list at once. */
+#define MAG_SIZE 8
+#define MAG_BATCH (MAG_SIZE / 2)
 
 /* Descriptor. */
 struct desc {
@@ -40,6 +63,8 @@ struct desc {
 	size_t blocks_per_arena;    /* Number of blocks in an arena. */
 	struct list free_list;      /* List of free blocks. */
 	struct lock lock;           /* Lock. */
+	void *mag[MAG_SIZE];        /* Magazine of free blocks. */
+	size_t mag_cnt;             /* Blocks in MAG; interrupts off. */
 };
 
 /* Magic number for detecting arena corruption. */
@@ -57,25 +82,55 @@ struct block {
 	struct list_elem free_elem; /* Free list element. */
 };
 
+/* Largest block handled by a descriptor: the biggest multiple of
+   16 of which an arena holds two. */
+#define MAX_BLOCK ROUND_DOWN ((PGSIZE - sizeof (struct arena)) / 2, 16)
+
 /* Our set of descriptors. */
-static struct desc descs[10];   /* Descriptors. */
+static struct desc descs[32];   /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
+/* Index into descs[] of the smallest descriptor whose blocks hold
+   N * 16 bytes. */
+static uint8_t size_class[MAX_BLOCK / 16 + 1];
+
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static struct desc *size_to_desc (size_t size);
+static struct block *take_block (struct desc *);
+static void put_block (struct desc *, struct block *);
 
 /* Initializes the malloc() descriptors. */
 void
 malloc_init (void) {
-	size_t block_size;
+	size_t block_size, n, i;
 
-	for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2) {
+	for (block_size = 16; block_size <= MAX_BLOCK; ) {
 		struct desc *d = &descs[desc_cnt++];
+		size_t step;
+
 		ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
 		d->block_size = block_size;
 		d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
 		list_init (&d->free_list);
 		lock_init (&d->lock);
+		d->mag_cnt = 0;
+
+		/* Step to the next class: 16 bytes up to 64, then a
+		   quarter of the power of 2 at or below BLOCK_SIZE, with
+		   MAX_BLOCK itself as the last class. */
+		for (step = 16; block_size >= 64 && step * 8 <= block_size; )
+			step *= 2;
+		if (block_size < MAX_BLOCK && block_size + step > MAX_BLOCK)
+			block_size = MAX_BLOCK;
+		else
+			block_size += step;
+	}
+
+	for (n = 0, i = 0; n < sizeof size_class; n++) {
+		while (descs[i].block_size < n * 16)
+			i++;
+		size_class[n] = i;
 	}
 }
 
@@ -86,6 +141,9 @@ malloc (size_t size) {
 	struct desc *d;
 	struct block *b;
 	struct arena *a;
+	struct block *batch[MAG_BATCH];
+	enum intr_level old_level;
+	size_t n;
 
 	/* A null pointer satisfies a request for 0 bytes. */
 	if (size == 0)
@@ -93,10 +151,8 @@ malloc (size_t size) {
 
 	/* Find the smallest descriptor that satisfies a SIZE-byte
 	   request. */
-	for (d = descs; d < descs + desc_cnt; d++)
-		if (d->block_size >= size)
-			break;
-	if (d == descs + desc_cnt) {
+	d = size_to_desc (size);
+	if (d == NULL) {
 		/* SIZE is too big for any descriptor.
 		   Allocate enough pages to hold SIZE plus an arena. */
 		size_t page_cnt = DIV_ROUND_UP (size + sizeof *a, PGSIZE);
@@ -112,6 +168,15 @@ malloc (size_t size) {
 		return a + 1;
 	}
 
+	/* Take a block from the magazine if it has one. */
+	old_level = intr_disable ();
+	if (d->mag_cnt > 0) {
+		b = d->mag[--d->mag_cnt];
+		intr_set_level (old_level);
+		return b;
+	}
+	intr_set_level (old_level);
+
 	lock_acquire (&d->lock);
 
 	/* If the free list is empty, create a new arena. */
@@ -135,10 +200,19 @@ malloc (size_t size) {
 		}
 	}
 
-	/* Get a block from free list and return it. */
-	b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
-	a = block_to_arena (b);
-	a->free_cnt--;
+	/* Get a block from free list to return, and refill the
+	   magazine from what is left.  We may have been preempted
+	   by a thread that filled it meanwhile, so put back any
+	   blocks that no longer fit. */
+	b = take_block (d);
+	for (n = 0; n < MAG_BATCH && !list_empty (&d->free_list); n++)
+		batch[n] = take_block (d);
+	old_level = intr_disable ();
+	while (n > 0 && d->mag_cnt < MAG_SIZE)
+		d->mag[d->mag_cnt++] = batch[--n];
+	intr_set_level (old_level);
+	while (n > 0)
+		put_block (d, batch[--n]);
 	lock_release (&d->lock);
 	return b;
 }
@@ -185,7 +259,27 @@ realloc (void *old_block, size_t new_size) {
 		free (old_block);
 		return NULL;
 	} else {
-		void *new_block = malloc (new_size);
+		void *new_block;
+
+		/* Resize in place if we can. */
+		if (old_block != NULL) {
+			struct arena *a = block_to_arena (old_block);
+
+			if (a->desc != NULL) {
+				if (size_to_desc (new_size) == a->desc)
+					return old_block;
+			} else if (new_size > MAX_BLOCK) {
+				size_t page_cnt = DIV_ROUND_UP (new_size + sizeof *a, PGSIZE);
+				if (page_cnt <= a->free_cnt) {
+					palloc_free_multiple ((uint8_t *) a + page_cnt * PGSIZE,
+							a->free_cnt - page_cnt);
+					a->free_cnt = page_cnt;
+					return old_block;
+				}
+			}
+		}
+
+		new_block = malloc (new_size);
 		if (old_block != NULL && new_block != NULL) {
 			size_t old_size = block_size (old_block);
 			size_t min_size = new_size < old_size ? new_size : old_size;
@@ -207,29 +301,34 @@ free (void *p) {
 
 		if (d != NULL) {
 			/* It's a normal block.  We handle it here. */
+			struct block *batch[MAG_BATCH];
+			enum intr_level old_level;
+			size_t n;
 
 #ifndef NDEBUG
 			/* Clear the block to help detect use-after-free bugs. */
 			memset (b, 0xcc, d->block_size);
 #endif
 
-			lock_acquire (&d->lock);
-
-			/* Add block to free list. */
-			list_push_front (&d->free_list, &b->free_elem);
-
-			/* If the arena is now entirely unused, free it. */
-			if (++a->free_cnt >= d->blocks_per_arena) {
-				size_t i;
-
-				ASSERT (a->free_cnt == d->blocks_per_arena);
-				for (i = 0; i < d->blocks_per_arena; i++) {
-					struct block *b = arena_to_block (a, i);
-					list_remove (&b->free_elem);
-				}
-				palloc_free_page (a);
+			/* Put the block in the magazine if it has room. */
+			old_level = intr_disable ();
+			if (d->mag_cnt < MAG_SIZE) {
+				d->mag[d->mag_cnt++] = b;
+				intr_set_level (old_level);
+				return;
 			}
+			intr_set_level (old_level);
 
+			/* Otherwise return it, and a batch from the magazine,
+			   to the free list. */
+			lock_acquire (&d->lock);
+			old_level = intr_disable ();
+			for (n = 0; n < MAG_BATCH && d->mag_cnt > 0; n++)
+				batch[n] = d->mag[--d->mag_cnt];
+			intr_set_level (old_level);
+			while (n > 0)
+				put_block (d, batch[--n]);
+			put_block (d, b);
 			lock_release (&d->lock);
 		} else {
 			/* It's a big block.  Free its pages. */
@@ -238,6 +337,22 @@ free (void *p) {
 		}
 	}
 }
+
+/* Returns the number of pages that malloc() uses for CNT blocks
+   of SIZE bytes each, with every arena full, so that other
+   allocators can compare their footprint with it. */
+size_t
+malloc_pages (size_t size, size_t cnt) {
+	struct desc *d;
+
+	if (size == 0 || cnt == 0)
+		return 0;
+
+	d = size_to_desc (size);
+	if (d == NULL)
+		return cnt * DIV_ROUND_UP (size + sizeof (struct arena), PGSIZE);
+	return DIV_ROUND_UP (cnt, d->blocks_per_arena);
+}
 
 /* Returns the arena that block B is inside. */
 static struct arena *
@@ -266,3 +381,46 @@ arena_to_block (struct arena *a, size_t idx) {
 			+ sizeof *a
 			+ idx * a->desc->block_size);
 }
+
+/* Returns the smallest descriptor whose blocks hold SIZE bytes,
+   or a null pointer if SIZE is too big for any descriptor. */
+static struct desc *
+size_to_desc (size_t size) {
+	if (size > MAX_BLOCK)
+		return NULL;
+	return &descs[size_class[DIV_ROUND_UP (size, 16)]];
+}
+
+/* Removes a block from D's free list, which must not be empty,
+   and returns it.  D's lock must be held. */
+static struct block *
+take_block (struct desc *d) {
+	struct block *b;
+
+	ASSERT (lock_held_by_current_thread (&d->lock));
+
+	b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
+	block_to_arena (b)->free_cnt--;
+	return b;
+}
+
+/* Adds block B to D's free list, and frees its arena if that
+   leaves the arena entirely unused.  D's lock must be held. */
+static void
+put_block (struct desc *d, struct block *b) {
+	struct arena *a = block_to_arena (b);
+
+	ASSERT (lock_held_by_current_thread (&d->lock));
+
+	list_push_front (&d->free_list, &b->free_elem);
+	if (++a->free_cnt >= d->blocks_per_arena) {
+		size_t i;
+
+		ASSERT (a->free_cnt == d->blocks_per_arena);
+		for (i = 0; i < d->blocks_per_arena; i++) {
+			struct block *b = arena_to_block (a, i);
+			list_remove (&b->free_elem);
+		}
+		palloc_free_page (a);
+	}
+}
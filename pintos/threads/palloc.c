@@ -2,15 +2,19 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/loader.h"
-#include "threads/synch.h"
 #include "threads/vaddr.h"
+#ifdef VM
+#include "vm/compact.h"
+#endif
 
 /* Page allocator.  Hands out memory in page-size (or
    page-multiple) chunks.  See malloc.h for an allocator that
@@ -24,24 +28,151 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   The split is only where the pools start out.  Both pools span
+   all of memory, each marking the pages that it does not own as
+   allocated, and PAGE_OWNER records which pool owns each page.
+   When a pool cannot satisfy a request, it borrows an aligned
+   block of 2**CHUNK_ORDER free pages, or just enough for the
+   request if the other pool is too fragmented, from the other
+   pool, as long as that leaves the lender its reserve of free
+   pages.  A pool holding borrowed pages that has free pages well
+   beyond its own reserve gives them back: borrowed pages go back
+   as soon as they are freed, and free blocks on the other pool's
+   side of the boundary go back a chunk at a time.  The user pool
+   never grows past user_page_limit.
+
+   Each pool is a binary buddy allocator.  Free memory is kept as
+   blocks of 2**ORDER pages, aligned to their size relative to the
+   pool's base, on one free list per order.  An allocation takes
+   the smallest block that is big enough, splitting larger ones as
+   needed, and a request for a page count that is not a power of
+   two gives the unused tail of its block straight back.  A freed
+   range is broken into aligned blocks, each of which merges with
+   its buddy for as long as the buddy is free too.  Both take
+   O(lg n) steps per block, where the old first-fit bitmap scan
+   took O(n).  Each free block records its order in the pool's
+   ORDERS array, indexed by the block's first page, and links
+   itself into its free list through its own first page.
+
+   Single pages, which are most requests, first go through a small
+   LIFO cache of recently freed pages, which skips the buddy lists
+   and tends to hand back pages that are still warm in the CPU
+   cache.  The cache is flushed back into the buddy lists when a
+   larger allocation would otherwise fail.
+
+   Single pages requested with PAL_ZERO come first from a second
+   cache, of pages that the idle thread zeroed ahead of time with
+   palloc_zero_idle(), so that they cost a pop instead of a
+   memset() in the caller.  The pages cannot link themselves into
+   a list without being dirtied, so the cache is an array.  It is
+   flushed along with the other one.
+
+   A page that holds a user frame which the VM can move elsewhere
+   is marked in MOVABLE_MAP.  When a multi-page request still
+   fails, palloc_isolate() picks an aligned block of the user pool
+   made up of free and movable pages only, the VM migrates the
+   movable ones out (see vm/compact.c), and the whole block is
+   freed, so that the request can be retried.  While the block is
+   isolated, its pages that are freed, whether their frames were
+   migrated or their owners let them go, are held for the block in
+   ISOLATED_MAP instead of going back to the pool, so the VM can
+   migrate one frame at a time with interrupts on in between.
+
+   The pools are protected by disabling interrupts rather than by
+   locks, since pages are freed from inside the scheduler, where
+   the running thread cannot block. */
+
+/* Number of block orders: the largest block is 2**(ORDER_CNT - 1)
+   pages. */
+#define ORDER_CNT 16
+
+/* ORDERS value for a page that does not begin a free block. */
+#define NOT_FREE 0xff
+
+/* Capacity of each pool's cache of free single pages. */
+#define HOT_PAGES 32
+
+/* Capacity of each pool's cache of zeroed free pages. */
+#define ZERO_PAGES 64
+
+/* Pages are borrowed, when possible, and given back in aligned
+   blocks of at least 2**CHUNK_ORDER pages. */
+#define CHUNK_ORDER 6
+#define CHUNK_PAGES ((size_t) 1 << CHUNK_ORDER)
 
 /* A memory pool. */
 struct pool {
-	struct lock lock;               /* Mutual exclusion. */
-	struct bitmap *used_map;        /* Bitmap of free pages. */
+	const char *name;               /* For statistics. */
+	struct bitmap *used_map;        /* Bitmap of allocated pages. */
 	uint8_t *base;                  /* Base of pool. */
+	uint8_t *orders;                /* Order of the free block at each
+	                                   page, or NOT_FREE. */
+	struct list free_lists[ORDER_CNT];  /* Free blocks by order. */
+	size_t free_cnt;                /* Free pages, including cached. */
+	void *hot[HOT_PAGES];           /* Cache of free single pages. */
+	size_t hot_cnt;                 /* Pages in HOT. */
+	long long hot_hits;             /* Single pages served from HOT. */
+	long long hot_misses;           /* Single pages from the lists. */
+	void *zero[ZERO_PAGES];         /* Cache of zeroed free pages. */
+	size_t zero_cnt;                /* Pages in ZERO. */
+	long long zero_hits;            /* PAL_ZERO pages served from ZERO. */
+	long long zero_misses;          /* PAL_ZERO pages zeroed on demand. */
+	long long zero_filled;          /* Pages zeroed by the idle thread. */
+	size_t page_cnt;                /* Usable pages owned. */
+	size_t reserve;                 /* Free pages never lent out. */
+	size_t borrowed;                /* Owned pages on the other side of
+	                                   the boundary. */
+	long long pressure;             /* Requests that found it short. */
+	long long borrow_cnt;           /* Blocks borrowed. */
+	long long borrow_pages;         /* Pages borrowed. */
+	long long return_cnt;           /* Blocks given back. */
+	long long return_pages;         /* Pages given back. */
 };
 
 /* Two pools: one for kernel data, one for user pages. */
 static struct pool kernel_pool, user_pool;
 
+/* Pages below this address start out in the kernel pool, the
+   rest in the user pool. */
+static uint8_t *pool_split;
+
+/* Owner of each page, indexed like the pools' bitmaps: 0 for the
+   kernel pool, 1 for the user pool. */
+static uint8_t *page_owner;
+
+/* Pages holding user frames that may be migrated, indexed like
+   PAGE_OWNER. */
+static struct bitmap *movable_map;
+
+/* The isolated block of the user pool, if any, and its pages that
+   are free but held for it, indexed like PAGE_OWNER. */
+static size_t isolated_idx = BITMAP_ERROR;
+static size_t isolated_cnt;
+static struct bitmap *isolated_map;
+
 /* Maximum number of pages to put in user pool. */
 size_t user_page_limit = SIZE_MAX;
 static void
-init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end);
+init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end,
+		const char *name);
 
-static bool page_from_pool (const struct pool *, void *page);
+static struct pool *page_pool (void *page);
+static void add_range (struct pool *, uint64_t start, uint64_t end);
+static struct pool *other_pool (struct pool *);
+static size_t home_pages (const struct pool *, size_t page_idx,
+		size_t page_cnt);
+static size_t pool_spare (const struct pool *);
+static void move_pages (struct pool *from, struct pool *to,
+		size_t page_idx, size_t page_cnt);
+static bool pool_borrow (struct pool *, size_t page_cnt);
+static void pool_return (struct pool *);
+static size_t buddy_alloc (struct pool *, size_t page_cnt);
+static void buddy_free (struct pool *, size_t page_idx, size_t page_cnt);
+static void cache_flush (struct pool *);
+static void *pool_get (enum palloc_flags, size_t page_cnt);
+static void block_remove (struct pool *, size_t page_idx);
 
 /* multiboot info */
 struct multiboot_info {
@@ -133,6 +264,7 @@ populate_pools (struct area *base_mem, struct area *ext_mem) {
 	enum { KERN_START, KERN, USER_START, USER } state = KERN_START;
 	uint64_t rem = kern_pages;
 	uint64_t region_start = 0, end = 0, start, size, size_in_pg;
+	uint64_t mem_start = 0;
 
 	struct multiboot_info *mb_info = ptov (MULTIBOOT_INFO);
 	struct e820_entry *entries = ptov (mb_info->mmap_base);
@@ -157,9 +289,9 @@ populate_pools (struct area *base_mem, struct area *ext_mem) {
 						rem -= size_in_pg;
 						break;
 					}
-					// generate kernel pool
-					init_pool (&kernel_pool,
-							&free_start, region_start, start + rem * PGSIZE);
+					// The kernel pool's share ends here.
+					mem_start = region_start;
+					pool_split = (uint8_t *) (start + rem * PGSIZE);
 					// Transition to the next state
 					if (rem == size_in_pg) {
 						rem = user_pages;
@@ -187,14 +319,25 @@ populate_pools (struct area *base_mem, struct area *ext_mem) {
 		}
 	}
 
-	// generate the user pool
-	init_pool(&user_pool, &free_start, region_start, end);
+	// Generate the pools, each spanning all of memory, and the
+	// page owner map.
+	init_pool (&kernel_pool, &free_start, mem_start, end, "Kernel");
+	init_pool (&user_pool, &free_start, mem_start, end, "User");
+	size_t page_total = bitmap_size (kernel_pool.used_map);
+	size_t split_idx = pg_no (pool_split) - pg_no (kernel_pool.base);
+	page_owner = free_start;
+	memset (page_owner, 0, split_idx);
+	memset (page_owner + split_idx, 1, page_total - split_idx);
+	free_start += ROUND_UP (page_total, PGSIZE);
+	movable_map = bitmap_create_in_buf (page_total, free_start,
+			bitmap_buf_size (page_total));
+	free_start += ROUND_UP (bitmap_buf_size (page_total), PGSIZE);
+	isolated_map = bitmap_create_in_buf (page_total, free_start,
+			bitmap_buf_size (page_total));
+	free_start += ROUND_UP (bitmap_buf_size (page_total), PGSIZE);
 
 	// Iterate over the e820_entry. Setup the usable.
 	uint64_t usable_bound = (uint64_t) free_start;
-	struct pool *pool;
-	void *pool_end;
-	size_t page_idx, page_cnt;
 
 	for (i = 0; i < mb_info->mmap_len / sizeof (struct e820_entry); i++) {
 		struct e820_entry *entry = &entries[i];
@@ -211,27 +354,35 @@ populate_pools (struct area *base_mem, struct area *ext_mem) {
 
 			start = (uint64_t)
 				pg_round_up (start >= usable_bound ? start : usable_bound);
-split: 
-			if (page_from_pool (&kernel_pool, (void *) start))
-				pool = &kernel_pool;
-			else if (page_from_pool (&user_pool, (void *) start))
-				pool = &user_pool;
-			else
-				NOT_REACHED ();
-
-			pool_end = pool->base + bitmap_size (pool->used_map) * PGSIZE;
-			page_idx = pg_no (start) - pg_no (pool->base);
-			if ((uint64_t) pool_end < end) {
-				page_cnt = ((uint64_t) pool_end - start) / PGSIZE;
-				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
-				start = (uint64_t) pool_end;
-				goto split;
-			} else {
-				page_cnt = ((uint64_t) end - start) / PGSIZE;
-				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
-			}
+			if (start < (uint64_t) pool_split)
+				add_range (&kernel_pool, start,
+						end < (uint64_t) pool_split ? end : (uint64_t) pool_split);
+			if (end > (uint64_t) pool_split)
+				add_range (&user_pool,
+						start > (uint64_t) pool_split ? start : (uint64_t) pool_split,
+						end);
 		}
 	}
+
+	// Each pool keeps an eighth of its free pages from lending.
+	kernel_pool.reserve = kernel_pool.free_cnt / 8;
+	user_pool.reserve = user_pool.free_cnt / 8;
+}
+
+/* Adds the free pages from START to END to POOL, at boot, and
+   counts them in its free and owned page totals. */
+static void
+add_range (struct pool *pool, uint64_t start, uint64_t end) {
+	size_t page_idx, page_cnt;
+
+	if (end <= start)
+		return;
+	page_idx = pg_no (start) - pg_no (pool->base);
+	page_cnt = (end - start) / PGSIZE;
+	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	buddy_free (pool, page_idx, page_cnt);
+	pool->free_cnt += page_cnt;
+	pool->page_cnt += page_cnt;
 }
 
 /* Initializes the page allocator and get the memory size */
@@ -261,26 +412,78 @@ palloc_init (void) {
    FLAGS, in which case the kernel panics. */
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
-	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
-
-	lock_acquire (&pool->lock);
-	size_t page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-	lock_release (&pool->lock);
 	void *pages;
 
-	if (page_idx != BITMAP_ERROR)
-		pages = pool->base + PGSIZE * page_idx;
-	else
-		pages = NULL;
+	if (page_cnt == 0)
+		return NULL;
+
+	pages = pool_get (flags, page_cnt);
+#ifdef VM
+	/* Enough free pages may be scattered among user frames.  Move
+	   the frames out of the way and try again. */
+	if (pages == NULL && page_cnt > 1 && !intr_context ()
+			&& vm_compact (flags, page_cnt))
+		pages = pool_get (flags, page_cnt);
+#endif
+	if (pages == NULL && (flags & PAL_ASSERT))
+		PANIC ("palloc_get: out of pages");
+
+	return pages;
+}
+
+/* Does the work of palloc_get_multiple(), except that it returns
+   a null pointer instead of panicking. */
+static void *
+pool_get (enum palloc_flags flags, size_t page_cnt) {
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	enum intr_level old_level;
+	void *pages = NULL;
+	size_t page_idx;
+	bool zeroed = false;
 
-	if (pages) {
-		if (flags & PAL_ZERO)
-			memset (pages, 0, PGSIZE * page_cnt);
+	old_level = intr_disable ();
+	if (page_cnt == 1 && (flags & PAL_ZERO) && pool->zero_cnt > 0) {
+		pages = pool->zero[--pool->zero_cnt];
+		page_idx = pg_no (pages) - pg_no (pool->base);
+		pool->zero_hits++;
+		zeroed = true;
+	} else if (page_cnt == 1 && pool->hot_cnt > 0) {
+		pages = pool->hot[--pool->hot_cnt];
+		page_idx = pg_no (pages) - pg_no (pool->base);
+		pool->hot_hits++;
 	} else {
-		if (flags & PAL_ASSERT)
-			PANIC ("palloc_get: out of pages");
+		page_idx = buddy_alloc (pool, page_cnt);
+		if (page_idx == BITMAP_ERROR
+				&& (pool->hot_cnt > 0 || pool->zero_cnt > 0)) {
+			/* The caches may be holding the pages that would have
+			   let the lists satisfy this request. */
+			cache_flush (pool);
+			page_idx = buddy_alloc (pool, page_cnt);
+		}
+		if (page_idx == BITMAP_ERROR) {
+			/* Borrow from the other pool. */
+			pool->pressure++;
+			if (pool_borrow (pool, page_cnt))
+				page_idx = buddy_alloc (pool, page_cnt);
+		}
+		if (page_idx != BITMAP_ERROR) {
+			pages = pool->base + PGSIZE * page_idx;
+			if (page_cnt == 1)
+				pool->hot_misses++;
+		}
+	}
+	if (pages != NULL) {
+		ASSERT (bitmap_none (pool->used_map, page_idx, page_cnt));
+		ASSERT (pool->free_cnt >= page_cnt);
+		bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+		pool->free_cnt -= page_cnt;
+		if (page_cnt == 1 && (flags & PAL_ZERO) && !zeroed)
+			pool->zero_misses++;
 	}
+	intr_set_level (old_level);
 
+	if (pages != NULL && (flags & PAL_ZERO) && !zeroed)
+		memset (pages, 0, PGSIZE * page_cnt);
 	return pages;
 }
 
@@ -299,6 +502,7 @@ palloc_get_page (enum palloc_flags flags) {
 /* Frees the PAGE_CNT pages starting at PAGES. */
 void
 palloc_free_multiple (void *pages, size_t page_cnt) {
+	enum intr_level old_level;
 	struct pool *pool;
 	size_t page_idx;
 
@@ -306,20 +510,42 @@ palloc_free_multiple (void *pages, size_t page_cnt) {
 	if (pages == NULL || page_cnt == 0)
 		return;
 
-	if (page_from_pool (&kernel_pool, pages))
-		pool = &kernel_pool;
-	else if (page_from_pool (&user_pool, pages))
-		pool = &user_pool;
-	else
-		NOT_REACHED ();
-
+	pool = page_pool (pages);
 	page_idx = pg_no (pages) - pg_no (pool->base);
 
 #ifndef NDEBUG
 	memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
+
+	old_level = intr_disable ();
 	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
+	if (pool == &user_pool && isolated_idx != BITMAP_ERROR
+			&& page_idx < isolated_idx + isolated_cnt
+			&& page_idx + page_cnt > isolated_idx) {
+		/* Hold the pages for the isolated block. */
+		ASSERT (page_idx >= isolated_idx
+				&& page_idx + page_cnt <= isolated_idx + isolated_cnt);
+		bitmap_set_multiple (movable_map, page_idx, page_cnt, false);
+		bitmap_set_multiple (isolated_map, page_idx, page_cnt, true);
+		intr_set_level (old_level);
+		return;
+	}
 	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	bitmap_set_multiple (movable_map, page_idx, page_cnt, false);
+	pool->free_cnt += page_cnt;
+	if (pool->borrowed > 0 && home_pages (pool, page_idx, page_cnt) == 0
+			&& pool_spare (pool) >= page_cnt) {
+		/* Borrowed pages that we can spare go straight back. */
+		move_pages (pool, other_pool (pool), page_idx, page_cnt);
+		pool->return_cnt++;
+		pool->return_pages += page_cnt;
+	} else if (page_cnt == 1 && pool->hot_cnt < HOT_PAGES)
+		pool->hot[pool->hot_cnt++] = pages;
+	else
+		buddy_free (pool, page_idx, page_cnt);
+	if (pool->borrowed > 0)
+		pool_return (pool);
+	intr_set_level (old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -328,31 +554,596 @@ palloc_free_page (void *page) {
 	palloc_free_multiple (page, 1);
 }
 
-/* Initializes pool P as starting at START and ending at END */
+/* Zeroes a free page and adds it to the zeroed page cache of the
+   first pool whose cache has room.  Returns false if there was
+   no such pool with a free page, true otherwise.  Called by the
+   idle thread, with interrupts on, so the page is taken out of
+   the pool while it is zeroed. */
+bool
+palloc_zero_idle (void) {
+	struct pool *pools[] = { &kernel_pool, &user_pool };
+	size_t i;
+
+	for (i = 0; i < sizeof pools / sizeof *pools; i++) {
+		struct pool *p = pools[i];
+		enum intr_level old_level;
+		size_t page_idx;
+		void *page;
+
+		old_level = intr_disable ();
+		if (p->zero_cnt >= ZERO_PAGES) {
+			intr_set_level (old_level);
+			continue;
+		}
+		if (p->hot_cnt > 0)
+			page_idx = pg_no (p->hot[--p->hot_cnt]) - pg_no (p->base);
+		else {
+			page_idx = buddy_alloc (p, 1);
+			if (page_idx == BITMAP_ERROR) {
+				intr_set_level (old_level);
+				continue;
+			}
+		}
+		bitmap_mark (p->used_map, page_idx);
+		p->free_cnt--;
+		intr_set_level (old_level);
+
+		page = p->base + PGSIZE * page_idx;
+		memset (page, 0, PGSIZE);
+
+		old_level = intr_disable ();
+		bitmap_reset (p->used_map, page_idx);
+		p->free_cnt++;
+		if (p->zero_cnt < ZERO_PAGES) {
+			p->zero[p->zero_cnt++] = page;
+			p->zero_filled++;
+		} else
+			buddy_free (p, page_idx, 1);
+		intr_set_level (old_level);
+		return true;
+	}
+	return false;
+}
+
+/* Stores the number of zeroed pages cached in the user pool, if
+   FLAGS includes PAL_USER, or else the kernel pool, in *CACHED,
+   and the number of PAL_ZERO pages it served from that cache so
+   far in *HITS. */
+void
+palloc_zero_stats (enum palloc_flags flags, size_t *cached, long long *hits) {
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	enum intr_level old_level = intr_disable ();
+
+	*cached = pool->zero_cnt;
+	*hits = pool->zero_hits;
+	intr_set_level (old_level);
+}
+
+/* Marks PAGE, an allocated user pool page that holds a user
+   frame, as one that the frame may be migrated out of, or not. */
+void
+palloc_set_movable (void *page, bool movable) {
+	size_t page_idx = pg_no (page) - pg_no (user_pool.base);
+	enum intr_level old_level = intr_disable ();
+
+	ASSERT (page_pool (page) == &user_pool);
+	ASSERT (bitmap_test (user_pool.used_map, page_idx));
+	bitmap_set (movable_map, page_idx, movable);
+	intr_set_level (old_level);
+}
+
+/* Returns true if PAGE, an allocated user pool page, is marked
+   as one that its frame may be migrated out of. */
+bool
+palloc_movable (void *page) {
+	size_t page_idx = pg_no (page) - pg_no (user_pool.base);
+
+	ASSERT (page_pool (page) == &user_pool);
+	return bitmap_test (movable_map, page_idx);
+}
+
+/* Returns the number of pages in the smallest block that holds
+   PAGE_CNT pages, or 0 if there is no block that big. */
+static size_t
+block_pages (size_t page_cnt) {
+	int order;
+
+	for (order = 0; order < ORDER_CNT; order++)
+		if (((size_t) 1 << order) >= page_cnt)
+			return (size_t) 1 << order;
+	return 0;
+}
+
+/* Returns true if the user pool has the free pages for a block
+   big enough for PAGE_CNT pages, and room to move frames out of
+   it, but they are too scattered to form one. */
+bool
+palloc_fragmented (size_t page_cnt) {
+	size_t block_cnt = block_pages (page_cnt);
+	enum intr_level old_level;
+	bool fragmented;
+	int order;
+
+	if (block_cnt == 0)
+		return false;
+
+	old_level = intr_disable ();
+	fragmented = user_pool.free_cnt >= 2 * block_cnt;
+	for (order = 0; fragmented && order < ORDER_CNT; order++)
+		if (((size_t) 1 << order) >= block_cnt
+				&& !list_empty (&user_pool.free_lists[order]))
+			fragmented = false;
+	intr_set_level (old_level);
+	return fragmented;
+}
+
+/* Finds the aligned block of user pool pages, big enough for a
+   PAGE_CNT page request with FLAGS, that takes the fewest frame
+   migrations to empty, takes its free pages out of the pool, and
+   returns it, storing its size in pages in *BLOCK_CNT.  Every
+   page of the block is then allocated, and each movable one
+   holds a frame that the caller should migrate, then free its old
+   page, before handing the block to palloc_release_isolated().
+   Until then, pages of the block that are freed are held for it.
+   Returns a null pointer if no block qualifies, or if the user
+   pool could not take the moved frames, or lend the block to the
+   kernel pool without going below its reserve.  Only one block
+   may be isolated at a time.  Interrupts must be off. */
+void *
+palloc_isolate (enum palloc_flags flags, size_t page_cnt,
+		size_t *block_cnt) {
+	struct pool *pool = &user_pool;
+	size_t pool_pages = bitmap_size (pool->used_map);
+	size_t best_idx = BITMAP_ERROR, best_moves = SIZE_MAX;
+	size_t cnt = block_pages (page_cnt);
+	size_t need = cnt;
+	size_t idx, i;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (isolated_idx == BITMAP_ERROR);
+
+	/* The frames moved out of the block take as many free pages
+	   elsewhere as the block has used ones. */
+	if (!(flags & PAL_USER))
+		need += pool->reserve;
+	if (cnt == 0 || pool->free_cnt < need)
+		return NULL;
+
+	for (idx = 0; idx + cnt <= pool_pages; idx += cnt) {
+		size_t moves = 0;
+
+		for (i = idx; i < idx + cnt; i++) {
+			if (page_owner[i] != 1)
+				break;
+			if (bitmap_test (pool->used_map, i)) {
+				if (!bitmap_test (movable_map, i))
+					break;
+				moves++;
+			}
+		}
+		if (i == idx + cnt && moves > 0 && moves < best_moves) {
+			best_idx = idx;
+			best_moves = moves;
+		}
+	}
+	if (best_idx == BITMAP_ERROR)
+		return NULL;
+
+	/* Every free page in the block is now on the free lists, in
+	   blocks that lie within it, since blocks are aligned and the
+	   block is not wholly free. */
+	cache_flush (pool);
+	for (i = best_idx; i < best_idx + cnt; ) {
+		size_t free_cnt;
+
+		if (pool->orders[i] == NOT_FREE) {
+			i++;
+			continue;
+		}
+		free_cnt = (size_t) 1 << pool->orders[i];
+		ASSERT (i + free_cnt <= best_idx + cnt);
+		block_remove (pool, i);
+		bitmap_set_multiple (pool->used_map, i, free_cnt, true);
+		bitmap_set_multiple (isolated_map, i, free_cnt, true);
+		pool->free_cnt -= free_cnt;
+		i += free_cnt;
+	}
+
+	isolated_idx = best_idx;
+	isolated_cnt = cnt;
+	*block_cnt = cnt;
+	return pool->base + PGSIZE * best_idx;
+}
+
+/* Ends the isolation of the BLOCK_CNT page block at BLOCK,
+   returned by palloc_isolate(), and frees the pages held for it.
+   Pages that still hold a frame stay allocated.  Returns true if
+   the whole block was freed. */
+bool
+palloc_release_isolated (void *block, size_t block_cnt) {
+	size_t block_idx = pg_no (block) - pg_no (user_pool.base);
+	enum intr_level old_level;
+	size_t i = 0;
+	bool whole;
+
+	old_level = intr_disable ();
+	ASSERT (block_idx == isolated_idx && block_cnt == isolated_cnt);
+	isolated_idx = BITMAP_ERROR;
+	whole = bitmap_all (isolated_map, block_idx, block_cnt);
+	while (i < block_cnt) {
+		size_t run = 0;
+
+		while (i + run < block_cnt
+				&& bitmap_test (isolated_map, block_idx + i + run))
+			run++;
+		bitmap_set_multiple (isolated_map, block_idx + i, run, false);
+		palloc_free_multiple ((uint8_t *) block + PGSIZE * i, run);
+		i += run + 1;
+	}
+	intr_set_level (old_level);
+	return whole;
+}
+
+/* Prints the number of free pages in each pool, and how they
+   are split into blocks. */
+void
+palloc_print_stats (void) {
+	struct pool *pools[] = { &kernel_pool, &user_pool };
+	size_t i;
+	int order;
+
+	for (i = 0; i < sizeof pools / sizeof *pools; i++) {
+		struct pool *p = pools[i];
+		enum intr_level old_level = intr_disable ();
+		size_t blocks[ORDER_CNT];
+
+		for (order = 0; order < ORDER_CNT; order++)
+			blocks[order] = list_size (&p->free_lists[order]);
+		intr_set_level (old_level);
+
+		printf ("%s pool: %zu pages free, %zu cached; "
+				"%lld of %lld single pages from cache\n",
+				p->name, p->free_cnt, p->hot_cnt,
+				p->hot_hits, p->hot_hits + p->hot_misses);
+		printf ("%s pool: %zu zeroed pages cached, %lld zeroed when idle; "
+				"%lld of %lld PAL_ZERO pages from cache\n",
+				p->name, p->zero_cnt, p->zero_filled,
+				p->zero_hits, p->zero_hits + p->zero_misses);
+		printf ("%s pool: %zu pages owned, %zu borrowed; short %lld times, "
+				"borrowed %lld pages in %lld blocks, "
+				"returned %lld pages in %lld blocks\n",
+				p->name, p->page_cnt, p->borrowed, p->pressure,
+				p->borrow_pages, p->borrow_cnt,
+				p->return_pages, p->return_cnt);
+		printf ("%s pool: free blocks by order:", p->name);
+		for (order = 0; order < ORDER_CNT; order++)
+			printf (" %zu", blocks[order]);
+		printf ("\n");
+	}
+}
+
+/* Initializes pool P as starting at START and ending at END,
+   named NAME. */
 static void
-init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
-     and subtract it from the pool's size. */
+init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end,
+		const char *name) {
+  /* We'll put the pool's used_map and orders at BM_BASE.
+     Calculate the space needed for them. */
 	uint64_t pgcnt = (end - start) / PGSIZE;
-	size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (pgcnt), PGSIZE) * PGSIZE;
+	size_t bm_size = bitmap_buf_size (pgcnt);
+	size_t meta_size = ROUND_UP (bm_size + pgcnt, PGSIZE);
+	int order;
 
-	lock_init(&p->lock);
-	p->used_map = bitmap_create_in_buf (pgcnt, *bm_base, bm_pages);
+	p->name = name;
+	p->used_map = bitmap_create_in_buf (pgcnt, *bm_base, bm_size);
+	p->orders = (uint8_t *) *bm_base + bm_size;
 	p->base = (void *) start;
+	for (order = 0; order < ORDER_CNT; order++)
+		list_init (&p->free_lists[order]);
+	p->free_cnt = 0;
+	p->hot_cnt = 0;
+	p->zero_cnt = 0;
+	p->page_cnt = 0;
+	p->borrowed = 0;
 
-	// Mark all to unusable.
+	// Mark all to unusable, until populate_pools() frees them.
 	bitmap_set_all(p->used_map, true);
+	memset (p->orders, NOT_FREE, pgcnt);
 
-	*bm_base += bm_pages;
+	*bm_base += meta_size;
 }
 
-/* Returns true if PAGE was allocated from POOL,
-   false otherwise. */
-static bool
-page_from_pool (const struct pool *pool, void *page) {
+/* Returns the free list element in the first page of the block
+   at PAGE_IDX in POOL. */
+static struct list_elem *
+block_elem (const struct pool *pool, size_t page_idx) {
+	return (struct list_elem *) (pool->base + PGSIZE * page_idx);
+}
+
+/* Adds the free block of 2**ORDER pages at PAGE_IDX to POOL's
+   free lists. */
+static void
+block_insert (struct pool *pool, size_t page_idx, int order) {
+	pool->orders[page_idx] = order;
+	list_push_front (&pool->free_lists[order], block_elem (pool, page_idx));
+}
+
+/* Removes the free block at PAGE_IDX from POOL's free lists. */
+static void
+block_remove (struct pool *pool, size_t page_idx) {
+	ASSERT (pool->orders[page_idx] != NOT_FREE);
+	pool->orders[page_idx] = NOT_FREE;
+	list_remove (block_elem (pool, page_idx));
+}
+
+/* Takes PAGE_CNT contiguous pages off POOL's free lists and
+   returns the index of the first, or BITMAP_ERROR if there is no
+   block big enough. */
+static size_t
+buddy_alloc (struct pool *pool, size_t page_cnt) {
+	size_t page_idx;
+	int order, want;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	for (want = 0; want < ORDER_CNT && ((size_t) 1 << want) < page_cnt; want++)
+		continue;
+	for (order = want; order < ORDER_CNT; order++)
+		if (!list_empty (&pool->free_lists[order]))
+			break;
+	if (order >= ORDER_CNT)
+		return BITMAP_ERROR;
+
+	page_idx = pg_no (list_front (&pool->free_lists[order]))
+		- pg_no (pool->base);
+	block_remove (pool, page_idx);
+
+	/* Split off the upper halves that we do not need. */
+	while (order > want) {
+		order--;
+		block_insert (pool, page_idx + ((size_t) 1 << order), order);
+	}
+
+	/* Give back the tail beyond PAGE_CNT. */
+	if (((size_t) 1 << want) > page_cnt)
+		buddy_free (pool, page_idx + page_cnt,
+				((size_t) 1 << want) - page_cnt);
+	return page_idx;
+}
+
+/* Returns the PAGE_CNT pages starting at PAGE_IDX to POOL's free
+   lists, as the largest aligned blocks that fit, merging each
+   with its buddy for as long as the buddy is free. */
+static void
+buddy_free (struct pool *pool, size_t page_idx, size_t page_cnt) {
+	size_t pool_pages = bitmap_size (pool->used_map);
+
+	while (page_cnt > 0) {
+		size_t idx = page_idx;
+		int order = 0;
+
+		while (order + 1 < ORDER_CNT
+				&& (page_idx & (((size_t) 1 << (order + 1)) - 1)) == 0
+				&& ((size_t) 1 << (order + 1)) <= page_cnt)
+			order++;
+		page_idx += (size_t) 1 << order;
+		page_cnt -= (size_t) 1 << order;
+
+		for (; order + 1 < ORDER_CNT; order++) {
+			size_t buddy = idx ^ ((size_t) 1 << order);
+
+			if (buddy + ((size_t) 1 << order) > pool_pages
+					|| pool->orders[buddy] != order)
+				break;
+			block_remove (pool, buddy);
+			if (buddy < idx)
+				idx = buddy;
+		}
+		block_insert (pool, idx, order);
+	}
+}
+
+/* Returns the pages in POOL's single page and zeroed page caches
+   to its free lists. */
+static void
+cache_flush (struct pool *pool) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	while (pool->hot_cnt > 0) {
+		void *page = pool->hot[--pool->hot_cnt];
+		buddy_free (pool, pg_no (page) - pg_no (pool->base), 1);
+	}
+	while (pool->zero_cnt > 0) {
+		void *page = pool->zero[--pool->zero_cnt];
+		buddy_free (pool, pg_no (page) - pg_no (pool->base), 1);
+	}
+}
+
+/* Returns the pool that owns PAGE. */
+static struct pool *
+page_pool (void *page) {
 	size_t page_no = pg_no (page);
-	size_t start_page = pg_no (pool->base);
-	size_t end_page = start_page + bitmap_size (pool->used_map);
-	return page_no >= start_page && page_no < end_page;
+	size_t start_page = pg_no (kernel_pool.base);
+	size_t end_page = start_page + bitmap_size (kernel_pool.used_map);
+
+	ASSERT (page_no >= start_page && page_no < end_page);
+	return page_owner[page_no - start_page] == 0 ? &kernel_pool : &user_pool;
+}
+
+/* Returns the pool other than POOL. */
+static struct pool *
+other_pool (struct pool *pool) {
+	return pool == &kernel_pool ? &user_pool : &kernel_pool;
+}
+
+/* Returns how many of the PAGE_CNT pages starting at PAGE_IDX
+   started out in POOL, that is, lie on its side of pool_split. */
+static size_t
+home_pages (const struct pool *pool, size_t page_idx, size_t page_cnt) {
+	size_t split_idx = pg_no (pool_split) - pg_no (kernel_pool.base);
+	size_t below;
+
+	if (split_idx <= page_idx)
+		below = 0;
+	else if (split_idx >= page_idx + page_cnt)
+		below = page_cnt;
+	else
+		below = split_idx - page_idx;
+	return pool == &kernel_pool ? below : page_cnt - below;
+}
+
+/* Moves the PAGE_CNT free pages at PAGE_IDX, which must not be
+   on FROM's free lists or in its caches, to TO. */
+static void
+move_pages (struct pool *from, struct pool *to, size_t page_idx,
+		size_t page_cnt) {
+	size_t to_home = home_pages (to, page_idx, page_cnt);
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	bitmap_set_multiple (from->used_map, page_idx, page_cnt, true);
+	from->free_cnt -= page_cnt;
+	from->page_cnt -= page_cnt;
+	from->borrowed -= to_home;
+
+	memset (page_owner + page_idx, to == &kernel_pool ? 0 : 1, page_cnt);
+
+	bitmap_set_multiple (to->used_map, page_idx, page_cnt, false);
+	buddy_free (to, page_idx, page_cnt);
+	to->free_cnt += page_cnt;
+	to->page_cnt += page_cnt;
+	to->borrowed += page_cnt - to_home;
+}
+
+/* Takes a free block of 2**ORDER pages off the free lists of
+   LENDER, for POOL to borrow, and returns its index.  Returns
+   BITMAP_ERROR if LENDER has no such block or cannot spare one,
+   or if POOL is not allowed to grow that much. */
+static size_t
+take_loan (struct pool *pool, struct pool *lender, int order) {
+	size_t page_cnt = (size_t) 1 << order;
+	size_t page_idx;
+
+	if (pool == &user_pool && pool->page_cnt + page_cnt > user_page_limit)
+		return BITMAP_ERROR;
+	if (lender->free_cnt < lender->reserve + page_cnt)
+		return BITMAP_ERROR;
+
+	page_idx = buddy_alloc (lender, page_cnt);
+	if (page_idx == BITMAP_ERROR
+			&& (lender->hot_cnt > 0 || lender->zero_cnt > 0)) {
+		cache_flush (lender);
+		page_idx = buddy_alloc (lender, page_cnt);
+	}
+	return page_idx;
+}
+
+/* Moves a block of free pages big enough for a PAGE_CNT page
+   request from the other pool to POOL.  Returns true if
+   successful, false if the other pool cannot spare one. */
+static bool
+pool_borrow (struct pool *pool, size_t page_cnt) {
+	struct pool *lender = other_pool (pool);
+	size_t page_idx;
+	int want, order;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	for (want = 0; ((size_t) 1 << want) < page_cnt; want++)
+		if (want + 1 >= ORDER_CNT)
+			return false;
+
+	/* Prefer a whole chunk, so that the next requests need not
+	   borrow again, but settle for a block just big enough if the
+	   lender is too fragmented to have one. */
+	order = want > CHUNK_ORDER ? want : CHUNK_ORDER;
+	page_idx = take_loan (pool, lender, order);
+	if (page_idx == BITMAP_ERROR && order > want) {
+		order = want;
+		page_idx = take_loan (pool, lender, order);
+	}
+	if (page_idx == BITMAP_ERROR)
+		return false;
+
+	move_pages (lender, pool, page_idx, (size_t) 1 << order);
+	pool->borrow_cnt++;
+	pool->borrow_pages += (size_t) 1 << order;
+	return true;
+}
+
+/* Returns the free pages POOL can give back while keeping a chunk
+   of them beyond its reserve. */
+static size_t
+pool_spare (const struct pool *pool) {
+	size_t keep = pool->reserve + CHUNK_PAGES;
+
+	return pool->free_cnt > keep ? pool->free_cnt - keep : 0;
+}
+
+/* Returns true if the block of 2**ORDER pages at PAGE_IDX in POOL
+   contains an aligned chunk that lies wholly on the other pool's
+   side of pool_split. */
+static bool
+has_foreign_chunk (const struct pool *pool, size_t page_idx, int order) {
+	size_t split_idx = pg_no (pool_split) - pg_no (kernel_pool.base);
+	size_t end_idx = page_idx + ((size_t) 1 << order);
+
+	if (pool == &kernel_pool) {
+		size_t lo = split_idx > page_idx ? split_idx : page_idx;
+		return ROUND_UP (lo, CHUNK_PAGES) + CHUNK_PAGES <= end_idx;
+	} else {
+		size_t hi = split_idx < end_idx ? split_idx : end_idx;
+		return page_idx + CHUNK_PAGES <= hi;
+	}
+}
+
+/* Gives the parts of the block of 2**ORDER pages at PAGE_IDX,
+   already taken off POOL's free lists, that lie on the other
+   pool's side of pool_split back to the other pool, splitting it
+   as needed, and puts the rest back on POOL's free lists. */
+static void
+return_block (struct pool *pool, size_t page_idx, int order) {
+	struct pool *owner = other_pool (pool);
+	size_t page_cnt = (size_t) 1 << order;
+
+	if (home_pages (owner, page_idx, page_cnt) == page_cnt
+			&& page_cnt <= pool_spare (pool)) {
+		move_pages (pool, owner, page_idx, page_cnt);
+		pool->return_cnt++;
+		pool->return_pages += page_cnt;
+	} else if (order > CHUNK_ORDER
+			&& has_foreign_chunk (pool, page_idx, order)) {
+		return_block (pool, page_idx, order - 1);
+		return_block (pool, page_idx + page_cnt / 2, order - 1);
+	} else
+		buddy_free (pool, page_idx, page_cnt);
+}
+
+/* Gives free pages on the other pool's side of the boundary back
+   to it, for as long as POOL can spare them. */
+static void
+pool_return (struct pool *pool) {
+	int order;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	for (order = ORDER_CNT - 1; order >= CHUNK_ORDER; order--) {
+		struct list *list = &pool->free_lists[order];
+		struct list_elem *e = list_begin (list);
+
+		while (e != list_end (list)) {
+			size_t page_idx = pg_no (e) - pg_no (pool->base);
+
+			if (pool->borrowed == 0 || pool_spare (pool) < CHUNK_PAGES)
+				return;
+
+			/* Pieces put back by return_block() go to the front of
+			   the lists, so they are not visited again. */
+			e = list_next (e);
+			if (has_foreign_chunk (pool, page_idx, order)) {
+				block_remove (pool, page_idx);
+				return_block (pool, page_idx, order);
+			}
+		}
+	}
 }
@@ -0,0 +1,137 @@
+#include "threads/profile.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "threads/thread.h"
+
+/* Statistical sampling profiler.
+
+   Every PROFILE_INTERVAL timer ticks, the timer interrupt handler
+   records the address that it interrupted, whether that was in
+   user or kernel mode, and the name of the running thread, which
+   for a user process is also the name of its executable.  Samples
+   go into a fixed buffer, so the cost is one small copy per
+   sample and a bounded amount of memory; once the buffer is full,
+   further samples are only counted.
+
+   At power off, profile_print_stats() prints a flat histogram of
+   the samples, one line per distinct address, that
+   utils/profile-report can attribute to functions in kernel.o
+   and the user programs. */
+
+/* Maximum number of samples kept. */
+#define PROFILE_SAMPLES 4096
+
+/* One sample. */
+struct profile_sample
+  {
+    uint64_t rip;                       /* Interrupted instruction. */
+    char name[16];                      /* Running thread's name. */
+    bool user;                          /* Interrupted user mode? */
+  };
+
+unsigned profile_interval;
+
+static struct profile_sample samples[PROFILE_SAMPLES];
+static size_t sample_cnt;               /* Samples in SAMPLES. */
+static long long dropped_cnt;           /* Samples that did not fit. */
+static unsigned ticks_to_sample;        /* Ticks until the next sample. */
+
+static int compare_samples (const void *, const void *);
+
+/* Called by the timer interrupt handler on every tick, with the
+   interrupted frame IF_.  Takes a sample every PROFILE_INTERVAL
+   ticks. */
+void
+profile_tick (const struct intr_frame *if_)
+{
+  struct profile_sample *s;
+
+  ASSERT (intr_context ());
+
+  if (profile_interval == 0 || ++ticks_to_sample < profile_interval)
+    return;
+  ticks_to_sample = 0;
+
+  if (sample_cnt >= PROFILE_SAMPLES)
+    {
+      dropped_cnt++;
+      return;
+    }
+
+  s = &samples[sample_cnt++];
+  s->rip = if_->rip;
+  s->user = (if_->cs & 3) == 3;
+  strlcpy (s->name, thread_name (), sizeof s->name);
+}
+
+/* Prints the profile as one line per distinct sampled address,
+   with the number of samples taken there.  Stops sampling. */
+void
+profile_print_stats (void)
+{
+  enum intr_level old_level;
+  size_t user_cnt = 0;
+  size_t i, j;
+
+  if (profile_interval == 0)
+    return;
+
+  old_level = intr_disable ();
+  profile_interval = 0;
+  intr_set_level (old_level);
+
+  for (i = 0; i < sample_cnt; i++)
+    if (samples[i].user)
+      user_cnt++;
+  printf ("Profile: %zu samples, %zu kernel, %zu user, %lld dropped\n",
+          sample_cnt, sample_cnt - user_cnt, user_cnt, dropped_cnt);
+
+  qsort (samples, sample_cnt, sizeof *samples, compare_samples);
+  for (i = 0; i < sample_cnt; i = j)
+    {
+      for (j = i + 1; j < sample_cnt; j++)
+        if (compare_samples (&samples[i], &samples[j]) != 0)
+          break;
+      if (samples[i].user)
+        printf ("Profile: %#018"PRIx64" user %s %zu\n",
+                samples[i].rip, samples[i].name, j - i);
+      else
+        printf ("Profile: %#018"PRIx64" kernel %zu\n", samples[i].rip, j - i);
+    }
+}
+
+/* Returns the number of samples kept so far that were taken
+   while a thread named NAME was running. */
+size_t
+profile_sample_cnt (const char *name)
+{
+  enum intr_level old_level;
+  size_t cnt = 0;
+  size_t i;
+
+  old_level = intr_disable ();
+  for (i = 0; i < sample_cnt; i++)
+    if (!strcmp (samples[i].name, name))
+      cnt++;
+  intr_set_level (old_level);
+  return cnt;
+}
+
+/* Orders samples by mode, then, for user samples, by program,
+   then by address. */
+static int
+compare_samples (const void *a_, const void *b_)
+{
+  const struct profile_sample *a = a_;
+  const struct profile_sample *b = b_;
+  int cmp;
+
+  if (a->user != b->user)
+    return a->user ? 1 : -1;
+  if (a->user && (cmp = strcmp (a->name, b->name)) != 0)
+    return cmp;
+  return a->rip < b->rip ? -1 : a->rip > b->rip;
+}
@@ -0,0 +1,332 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* A slab allocator, after Bonwick's.
+
+   malloc() rounds every request up to one of its size classes,
+   which wastes up to 15 bytes on a small object and up to a
+   quarter of a larger object's size, and every call goes through
+   a shared size-class descriptor.  Kernel objects that are
+   allocated and freed often can instead get a cache of their
+   own.  A cache carves pages, called slabs, into objects of
+   exactly its object size, so a slab holds as many objects as
+   fit.
+
+   Each slab begins with a header, followed by a stack of the
+   indexes of its free objects, followed by the objects.  Keeping
+   the free list outside the objects lets a constructor set up an
+   object once, when its slab is created: a freed object must be
+   returned in its constructed state, and is handed out again as
+   it is.
+
+   A cache keeps its slabs on three lists: partial slabs, which
+   have both free and allocated objects and are allocated from
+   first; full slabs; and empty slabs.  One empty slab is kept to
+   absorb an alloc/free cycle at the boundary; any more are given
+   back to the page allocator as soon as they empty out, and
+   kmem_cache_shrink() gives back the last one. */
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* Object alignment. */
+#define SLAB_ALIGN 8
+
+/* Empty slabs a cache keeps rather than freeing. */
+#define SLAB_SPARE 1
+
+/* A cache of objects of one size. */
+struct kmem_cache {
+	const char *name;           /* For statistics. */
+	size_t obj_size;            /* Object size, rounded up for alignment. */
+	size_t req_size;            /* Object size as requested. */
+	size_t objs_per_slab;       /* Objects in each slab. */
+	size_t obj_offset;          /* Offset of first object in a slab. */
+	kmem_ctor_func *ctor;       /* Constructor, or null. */
+	struct lock lock;           /* Protects everything below. */
+	struct list partial;        /* Slabs with free and used objects. */
+	struct list full;           /* Slabs with no free objects. */
+	struct list empty;          /* Slabs with no used objects. */
+	size_t empty_cnt;           /* Slabs in EMPTY. */
+	size_t slab_cnt;            /* Slabs in all lists. */
+	size_t active_cnt;          /* Objects allocated. */
+	size_t peak_active;         /* Most objects ever allocated at once. */
+	size_t peak_slabs;          /* Most slabs ever held at once. */
+	struct list_elem elem;      /* Element in cache_list. */
+};
+
+/* Slab header, at the beginning of each slab's page. */
+struct slab {
+	unsigned magic;             /* Always set to SLAB_MAGIC. */
+	struct kmem_cache *cache;   /* Owning cache. */
+	struct list_elem elem;      /* Element in one of CACHE's lists. */
+	size_t free_cnt;            /* Free objects. */
+	uint16_t free[];            /* Indexes of free objects, a stack. */
+};
+
+/* All caches, for statistics. */
+static struct list cache_list;
+static struct lock cache_list_lock;
+static bool cache_list_ready;
+
+static struct slab *slab_create (struct kmem_cache *);
+static void slab_destroy (struct kmem_cache *, struct slab *);
+static struct slab *obj_to_slab (void *obj);
+
+/* Creates and returns a cache of objects of SIZE bytes, named
+   NAME, whose slabs call CTOR, if nonnull, on each object as
+   they are created.  Panics if memory is not available, since
+   caches are created at boot. */
+struct kmem_cache *
+kmem_cache_create (const char *name, size_t size, kmem_ctor_func *ctor) {
+	struct kmem_cache *c;
+	size_t n;
+
+	ASSERT (name != NULL);
+	ASSERT (size > 0 && size <= PGSIZE / 4);
+
+	c = malloc (sizeof *c);
+	if (c == NULL)
+		PANIC ("kmem_cache_create: out of memory");
+
+	c->name = name;
+	c->req_size = size;
+	c->obj_size = ROUND_UP (size, SLAB_ALIGN);
+	c->ctor = ctor;
+
+	/* Fit as many objects as we can after the header and the
+	   free index stack. */
+	for (n = PGSIZE / c->obj_size; ; n--) {
+		size_t offset = ROUND_UP (sizeof (struct slab)
+				+ n * sizeof (uint16_t), SLAB_ALIGN);
+		if (offset + n * c->obj_size <= PGSIZE) {
+			c->objs_per_slab = n;
+			c->obj_offset = offset;
+			break;
+		}
+	}
+	ASSERT (c->objs_per_slab > 0);
+
+	lock_init (&c->lock);
+	list_init (&c->partial);
+	list_init (&c->full);
+	list_init (&c->empty);
+	c->empty_cnt = c->slab_cnt = 0;
+	c->active_cnt = c->peak_active = c->peak_slabs = 0;
+
+	if (!cache_list_ready) {
+		list_init (&cache_list);
+		lock_init (&cache_list_lock);
+		cache_list_ready = true;
+	}
+	lock_acquire (&cache_list_lock);
+	list_push_back (&cache_list, &c->elem);
+	lock_release (&cache_list_lock);
+
+	return c;
+}
+
+/* Allocates and returns an object from cache C, or a null
+   pointer if memory is not available. */
+void *
+kmem_cache_alloc (struct kmem_cache *c) {
+	struct slab *s;
+	void *obj;
+
+	ASSERT (c != NULL);
+
+	lock_acquire (&c->lock);
+	if (!list_empty (&c->partial))
+		s = list_entry (list_front (&c->partial), struct slab, elem);
+	else if (!list_empty (&c->empty)) {
+		s = list_entry (list_pop_front (&c->empty), struct slab, elem);
+		c->empty_cnt--;
+		list_push_front (&c->partial, &s->elem);
+	} else {
+		s = slab_create (c);
+		if (s == NULL) {
+			lock_release (&c->lock);
+			return NULL;
+		}
+		list_push_front (&c->partial, &s->elem);
+	}
+
+	obj = (uint8_t *) s + c->obj_offset
+		+ s->free[--s->free_cnt] * c->obj_size;
+	if (s->free_cnt == 0) {
+		list_remove (&s->elem);
+		list_push_front (&c->full, &s->elem);
+	}
+	if (++c->active_cnt > c->peak_active)
+		c->peak_active = c->active_cnt;
+	lock_release (&c->lock);
+
+	return obj;
+}
+
+/* Allocates an object from cache C and fills it with zeros.
+   Only for caches without a constructor. */
+void *
+kmem_cache_zalloc (struct kmem_cache *c) {
+	void *obj;
+
+	ASSERT (c->ctor == NULL);
+
+	obj = kmem_cache_alloc (c);
+	if (obj != NULL)
+		memset (obj, 0, c->req_size);
+	return obj;
+}
+
+/* Returns OBJ, which must have been allocated from cache C, to
+   C.  Does nothing if OBJ is null. */
+void
+kmem_cache_free (struct kmem_cache *c, void *obj) {
+	struct slab *s;
+	size_t idx;
+
+	if (obj == NULL)
+		return;
+
+	s = obj_to_slab (obj);
+	ASSERT (s->cache == c);
+	idx = ((uint8_t *) obj - ((uint8_t *) s + c->obj_offset)) / c->obj_size;
+
+#ifndef NDEBUG
+	/* Clear the object to help detect use-after-free bugs, unless
+	   it must keep its constructed state. */
+	if (c->ctor == NULL)
+		memset (obj, 0xcc, c->obj_size);
+#endif
+
+	lock_acquire (&c->lock);
+	ASSERT (s->free_cnt < c->objs_per_slab);
+	if (s->free_cnt == 0) {
+		list_remove (&s->elem);
+		list_push_front (&c->partial, &s->elem);
+	}
+	s->free[s->free_cnt++] = idx;
+	c->active_cnt--;
+
+	if (s->free_cnt == c->objs_per_slab) {
+		list_remove (&s->elem);
+		if (c->empty_cnt < SLAB_SPARE) {
+			list_push_front (&c->empty, &s->elem);
+			c->empty_cnt++;
+		} else
+			slab_destroy (c, s);
+	}
+	lock_release (&c->lock);
+}
+
+/* Gives every empty slab in cache C back to the page allocator.
+   Returns the number of pages freed. */
+size_t
+kmem_cache_shrink (struct kmem_cache *c) {
+	size_t freed = 0;
+
+	lock_acquire (&c->lock);
+	while (!list_empty (&c->empty)) {
+		struct slab *s = list_entry (list_pop_front (&c->empty),
+				struct slab, elem);
+		c->empty_cnt--;
+		slab_destroy (c, s);
+		freed++;
+	}
+	lock_release (&c->lock);
+
+	return freed;
+}
+
+/* Returns the number of pages that cache C holds as slabs. */
+size_t
+kmem_cache_pages (struct kmem_cache *c) {
+	size_t cnt;
+
+	lock_acquire (&c->lock);
+	cnt = c->slab_cnt;
+	lock_release (&c->lock);
+
+	return cnt;
+}
+
+/* Prints each cache's usage at its peak, next to the pages that
+   malloc() would have needed for the same objects. */
+void
+kmem_print_stats (void) {
+	struct list_elem *e;
+
+	if (!cache_list_ready)
+		return;
+
+	lock_acquire (&cache_list_lock);
+	for (e = list_begin (&cache_list); e != list_end (&cache_list);
+			e = list_next (e)) {
+		struct kmem_cache *c = list_entry (e, struct kmem_cache, elem);
+
+		printf ("Slab %s: %zu-byte objects, %zu per slab; "
+				"peak %zu objects in %zu pages, malloc would use %zu\n",
+				c->name, c->req_size, c->objs_per_slab, c->peak_active,
+				c->peak_slabs, malloc_pages (c->req_size, c->peak_active));
+	}
+	lock_release (&cache_list_lock);
+}
+
+/* Allocates a new slab for cache C and constructs its objects.
+   Returns the slab, or a null pointer if memory is not
+   available. */
+static struct slab *
+slab_create (struct kmem_cache *c) {
+	struct slab *s;
+	size_t i;
+
+	ASSERT (lock_held_by_current_thread (&c->lock));
+
+	s = palloc_get_page (0);
+	if (s == NULL)
+		return NULL;
+
+	s->magic = SLAB_MAGIC;
+	s->cache = c;
+	s->free_cnt = c->objs_per_slab;
+	for (i = 0; i < c->objs_per_slab; i++) {
+		/* Hand out low addresses first. */
+		s->free[i] = c->objs_per_slab - 1 - i;
+		if (c->ctor != NULL)
+			c->ctor ((uint8_t *) s + c->obj_offset + i * c->obj_size);
+	}
+
+	if (++c->slab_cnt > c->peak_slabs)
+		c->peak_slabs = c->slab_cnt;
+	return s;
+}
+
+/* Frees slab S of cache C, which must not be on any list. */
+static void
+slab_destroy (struct kmem_cache *c, struct slab *s) {
+	ASSERT (s->free_cnt == c->objs_per_slab);
+
+	s->magic = 0;
+	c->slab_cnt--;
+	palloc_free_page (s);
+}
+
+/* Returns the slab that OBJ is inside. */
+static struct slab *
+obj_to_slab (void *obj) {
+	struct slab *s = pg_round_down (obj);
+
+	ASSERT (s->magic == SLAB_MAGIC);
+	ASSERT (pg_ofs (obj) >= s->cache->obj_offset);
+	ASSERT ((pg_ofs (obj) - s->cache->obj_offset) % s->cache->obj_size == 0);
+	return s;
+}
@@ -31,15 +31,31 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "intrinsic.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 
-static bool sem_priority_first(const struct list_elem *a_,
-                               const struct list_elem *b_, void *aux);
-static void priority_donation(void);
-static void remove_donor(struct lock *lock);
+/* -lockprof: Profile lock and semaphore contention? */
+bool lock_profile;
+
+/* Every init site that has been used since boot, if lock
+   profiling is enabled. */
+static struct sync_site *site_list;
+
+static bool waiter_first(const struct rb_node *a_, const struct rb_node *b_,
+                         void *aux);
+static void sema_wake(struct semaphore *sema);
+static void lock_release_no_yield(struct lock *lock);
+static bool donor_first(const struct rb_node *a_, const struct rb_node *b_,
+                        void *aux);
+static bool donation_first(const struct rb_node *a_,
+                           const struct rb_node *b_, void *aux);
+static int effective_priority(const struct thread *t);
+static void propagate_donation(struct lock *lock);
 static void sema_test_helper(void *sema_);
 static bool should_donation(int priority);
+static struct sync_site *site_register(struct sync_site *);
+static void site_account(struct sync_site *, uint64_t wait_start);
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -51,13 +67,18 @@ static bool should_donation(int priority);
    - up or "V": increment the value (and wake up one waiting
    thread, if any).
    - semaphore를 받고, sema value를 value로 선언함, list_init 실행
+
+   If lock profiling is enabled, SEMA's contention is charged to
+   SITE, which may be null to leave SEMA unprofiled.
    */
-void sema_init(struct semaphore *sema, unsigned value)
+void sema_init_at(struct semaphore *sema, unsigned value,
+                  struct sync_site *site)
 {
     ASSERT(sema != NULL);
 
     sema->value = value;
-    list_init(&sema->waiters);
+    wait_queue_init(&sema->waiters);
+    sema->site = site_register(site);
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -76,19 +97,21 @@ void sema_init(struct semaphore *sema, unsigned value)
 void sema_down(struct semaphore *sema)
 {
     enum intr_level old_level;
+    uint64_t wait_start = 0;
 
     ASSERT(sema != NULL);
     ASSERT(!intr_context());
 
     old_level = intr_disable();
 
+    if (sema->site != NULL && sema->value == 0) wait_start = rdtsc();
     while (sema->value == 0)
     {  // sema->value == 0이면, wait_list에 넣음
-        list_insert_ordered(&sema->waiters, &thread_current()->elem,
-                            priority_first, NULL);
+        wait_queue_push(&sema->waiters, thread_current());
         thread_block();
     }
     sema->value--;
+    if (sema->site != NULL) site_account(sema->site, wait_start);
     intr_set_level(old_level);
 }
 
@@ -112,6 +135,7 @@ bool sema_try_down(struct semaphore *sema)
     if (sema->value > 0)
     {
         sema->value--;
+        if (sema->site != NULL) site_account(sema->site, 0);
         success = true;
     }
     else
@@ -135,18 +159,22 @@ void sema_up(struct semaphore *sema)
     ASSERT(sema != NULL);
 
     old_level = intr_disable();
-
-    if (!list_empty(&sema->waiters))
-    {
-        list_sort(&sema->waiters, priority_first, NULL);
-        thread_unblock(
-            list_entry(list_pop_front(&sema->waiters), struct thread, elem));
-    }
-    sema->value++;
+    sema_wake(sema);
     if (!intr_context()) yield_to_higher_priority();
     intr_set_level(old_level);
 }
 
+/* Increments SEMA's value and unblocks its highest-priority
+   waiter, if any, without yielding.  Interrupts must be off. */
+static void sema_wake(struct semaphore *sema)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (!wait_queue_empty(&sema->waiters))
+        thread_unblock(wait_queue_pop(&sema->waiters));
+    sema->value++;
+}
+
 static bool should_donation(int target_priority)
 {
     return thread_current()->priority > target_priority;
@@ -200,24 +228,82 @@ static void sema_test_helper(void *sema_)
    another one "up" it, but with a lock the same thread must both
    acquire and release it.  When these restrictions prove
    onerous, it's a good sign that a semaphore should be used,
-   instead of a lock. */
-void lock_init(struct lock *lock)
+   instead of a lock.
+
+   If lock profiling is enabled, LOCK's contention and hold time
+   are charged to SITE. */
+void lock_init_at(struct lock *lock, struct sync_site *site)
 {
     ASSERT(lock != NULL);
 
     lock->holder = NULL;
-    sema_init(&lock->semaphore, 1);
+    lock->acquired_at = 0;
+    sema_init_at(&lock->semaphore, 1, site);
+    rb_init(&lock->donors, donor_first, NULL);
+    lock->donation = -1;
 }
 
-static void priority_donation()
+/* Initializes the priority donation state of thread T, which
+   holds no locks yet. */
+void lock_donation_init(struct thread *t)
 {
-    struct thread *cur = thread_current();
+    rb_init(&t->held_locks, donation_first, NULL);
+}
 
-    while (cur->wait_on_lock)
+/* Returns the priority T should run at: its own priority, or the
+   highest priority donated through any lock it holds. */
+static int effective_priority(const struct thread *t)
+{
+    int priority = t->origin_priority;
+
+    if (!rb_empty(&t->held_locks))
     {
-        struct thread *holder = cur->wait_on_lock->holder;
-        holder->priority = cur->priority;
-        cur = holder;
+        const struct lock *top =
+            rb_entry(rb_min(&t->held_locks), struct lock, held_node);
+        if (top->donation > priority) priority = top->donation;
+    }
+    return priority;
+}
+
+/* Brings LOCK's donation to its holder up to date after LOCK's
+   donors or holder changed, then follows the chain of locks that
+   the holder, and its holder in turn, are waiting on.
+
+   Each step takes O(lg n) time in the number of donors and held
+   locks involved, and the walk stops at the first lock whose
+   donation, or the first holder whose priority, does not change.
+   Interrupts must be off. */
+static void propagate_donation(struct lock *lock)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    while (lock != NULL && lock->holder != NULL)
+    {
+        struct thread *holder = lock->holder;
+        struct lock *next = holder->wait_on_lock;
+        int donation = -1;
+        int priority;
+
+        if (!rb_empty(&lock->donors))
+            donation = rb_entry(rb_min(&lock->donors), struct thread,
+                                donor_node)->priority;
+        if (donation == lock->donation) break;
+
+        /* Re-key LOCK in its holder's held locks. */
+        if (lock->donation >= 0)
+            rb_remove(&holder->held_locks, &lock->held_node);
+        lock->donation = donation;
+        if (donation >= 0) rb_insert(&holder->held_locks, &lock->held_node);
+
+        priority = effective_priority(holder);
+        if (priority == holder->priority) break;
+
+        /* Re-key the holder among the donors of the lock it is
+           waiting on, if any, and carry on from there. */
+        if (next != NULL) rb_remove(&next->donors, &holder->donor_node);
+        thread_update_priority(holder, priority);
+        if (next != NULL) rb_insert(&next->donors, &holder->donor_node);
+        lock = next;
     }
 }
 
@@ -231,27 +317,36 @@ static void priority_donation()
    we need to sleep. */
 void lock_acquire(struct lock *lock)
 {
+    struct thread *cur = thread_current();
+    enum intr_level old_level;
+
     ASSERT(lock != NULL);
     ASSERT(!intr_context());
     ASSERT(!lock_held_by_current_thread(lock));
 
-    struct thread *cur = thread_current();
-    if (lock->holder != NULL)
+    old_level = intr_disable();
+
+    /* Donate our priority while we wait.  The MLFQS does not use
+       priority donation. */
+    if (!thread_mlfqs && lock->holder != NULL)
     {
         cur->wait_on_lock = lock;
-
-        if (lock->holder->priority < cur->priority)
-        {
-            enum intr_level old_level = intr_disable();
-            list_insert_ordered(&lock->holder->donor_list, &cur->d_elem,
-                                priority_first, NULL);
-            priority_donation();
-            intr_set_level(old_level);
-        }
+        rb_insert(&lock->donors, &cur->donor_node);
+        propagate_donation(lock);
     }
 
     sema_down(&lock->semaphore);
+
+    if (cur->wait_on_lock != NULL)
+    {
+        cur->wait_on_lock = NULL;
+        rb_remove(&lock->donors, &cur->donor_node);
+    }
     lock->holder = cur;
+    if (!thread_mlfqs) propagate_donation(lock);
+    if (lock->semaphore.site != NULL) lock->acquired_at = rdtsc();
+
+    intr_set_level(old_level);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -262,45 +357,36 @@ void lock_acquire(struct lock *lock)
    interrupt handler. */
 bool lock_try_acquire(struct lock *lock)
 {
+    enum intr_level old_level;
     bool success;
 
     ASSERT(lock != NULL);
     ASSERT(!lock_held_by_current_thread(lock));
 
+    old_level = intr_disable();
     success = sema_try_down(&lock->semaphore);
-    if (success) lock->holder = thread_current();
-    return success;
-}
-
-void refresh_priority(void)
-{
-    struct thread *cur = thread_current();
-
-    cur->priority = cur->origin_priority;
-
-    if (!list_empty(&cur->donor_list))
+    if (success)
     {
-        struct thread *front =
-            list_entry(list_front(&cur->donor_list), struct thread, d_elem);
+        lock->holder = thread_current();
 
-        if (front->priority > cur->priority) cur->priority = front->priority;
+        /* Threads woken by the last release but not yet running
+           are still waiting, and now donate to us. */
+        if (!thread_mlfqs) propagate_donation(lock);
+        if (lock->semaphore.site != NULL) lock->acquired_at = rdtsc();
     }
+    intr_set_level(old_level);
+    return success;
 }
 
-static void remove_donor(struct lock *lock)
+/* Recomputes the current thread's priority from its own priority
+   and the donations it receives. */
+void refresh_priority(void)
 {
-    struct list_elem *e;
     struct thread *cur = thread_current();
+    enum intr_level old_level = intr_disable();
 
-    for (e = list_begin(&cur->donor_list); e != list_end(&cur->donor_list);)
-    {
-        struct thread *t = list_entry(e, struct thread, d_elem);
-
-        if (t->wait_on_lock == lock)
-            e = list_remove(&t->d_elem);
-        else
-            e = list_next(e);
-    }
+    thread_update_priority(cur, effective_priority(cur));
+    intr_set_level(old_level);
 }
 
 /* Releases LOCK, which must be owned by the current thread.
@@ -311,15 +397,40 @@ static void remove_donor(struct lock *lock)
    handler. */
 void lock_release(struct lock *lock)
 {
+    enum intr_level old_level;
+
     ASSERT(lock != NULL);
     ASSERT(lock_held_by_current_thread(lock));
 
-    remove_donor(lock);
+    old_level = intr_disable();
+    lock_release_no_yield(lock);
+    intr_set_level(old_level);
+    yield_to_higher_priority();
+}
+
+/* Releases LOCK, which must be owned by the current thread, but
+   leaves it to the caller to yield to any higher-priority thread
+   this wakes up.  Interrupts must be off. */
+static void lock_release_no_yield(struct lock *lock)
+{
+    struct thread *cur = thread_current();
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (lock->semaphore.site != NULL)
+        lock->semaphore.site->hold_cycles += rdtsc() - lock->acquired_at;
+
+    /* Give up the donations that came through LOCK.  Its donors
+       stay with it and will donate to the next holder. */
+    if (lock->donation >= 0)
+    {
+        rb_remove(&cur->held_locks, &lock->held_node);
+        lock->donation = -1;
+    }
     lock->holder = NULL;
-    sema_up(&lock->semaphore);
+    if (!thread_mlfqs) thread_update_priority(cur, effective_priority(cur));
 
-    refresh_priority();
-    yield_to_higher_priority();
+    sema_wake(&lock->semaphore);
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -332,13 +443,83 @@ bool lock_held_by_current_thread(const struct lock *lock)
     return lock->holder == thread_current();
 }
 
-/* One semaphore in a list. */
-struct semaphore_elem
+/* Returns SITE after adding it to the list of profiled sites, if
+   lock profiling is enabled, or a null pointer otherwise. */
+static struct sync_site *site_register(struct sync_site *site)
 {
-    struct list_elem elem;      /* List element. */
-    struct semaphore semaphore; /* This semaphore. */
-    int priority;
-};
+    enum intr_level old_level;
+
+    if (!lock_profile || site == NULL) return NULL;
+
+    old_level = intr_disable();
+    if (!site->registered)
+    {
+        site->registered = true;
+        site->next = site_list;
+        site_list = site;
+    }
+    intr_set_level(old_level);
+    return site;
+}
+
+/* Charges one acquire to SITE, which had to wait since
+   WAIT_START, or did not wait at all if WAIT_START is 0.
+   Interrupts must be off. */
+static void site_account(struct sync_site *site, uint64_t wait_start)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    site->acquires++;
+    if (wait_start != 0)
+    {
+        uint64_t wait = rdtsc() - wait_start;
+
+        site->contended++;
+        site->wait_cycles += wait;
+        if (wait > site->max_wait_cycles) site->max_wait_cycles = wait;
+    }
+}
+
+/* Prints contention statistics for every lock and semaphore init
+   site that was used, most waited-on first, if lock profiling is
+   enabled. */
+void lock_print_stats(void)
+{
+    struct sync_site *sorted = NULL, *site, *next, **p;
+    enum intr_level old_level;
+
+    if (!lock_profile) return;
+
+    /* Insertion sort by total wait time. */
+    old_level = intr_disable();
+    for (site = site_list; site != NULL; site = next)
+    {
+        next = site->next;
+        for (p = &sorted; *p != NULL && (*p)->wait_cycles >= site->wait_cycles;
+             p = &(*p)->next)
+            continue;
+        site->next = *p;
+        *p = site;
+    }
+    site_list = sorted;
+    intr_set_level(old_level);
+
+    printf("Locks: acquires, contended, wait cycles (max), hold cycles "
+           "by init site\n");
+    for (site = site_list; site != NULL; site = site->next)
+    {
+        const char *file = site->file;
+
+        if (site->acquires == 0) continue;
+        while (file[0] == '.' && file[1] == '.' && file[2] == '/')
+            file += 3;
+        printf("  %s:%d %s: %llu, %llu, %llu (%llu)", file, site->line,
+               site->is_lock ? "lock" : "sema", site->acquires,
+               site->contended, site->wait_cycles, site->max_wait_cycles);
+        if (site->is_lock) printf(", %llu", site->hold_cycles);
+        printf("\n");
+    }
+}
 
 /* Initializes condition variable COND.  A condition variable
    allows one piece of code to signal a condition and cooperating
@@ -347,7 +528,7 @@ void cond_init(struct condition *cond)
 {
     ASSERT(cond != NULL);
 
-    list_init(&cond->waiters);
+    wait_queue_init(&cond->waiters);
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -385,20 +566,21 @@ void cond_init(struct condition *cond)
    */
 void cond_wait(struct condition *cond, struct lock *lock)
 {
-    struct semaphore_elem waiter;
-    waiter.priority = thread_current()->priority;
+    enum intr_level old_level;
 
     ASSERT(cond != NULL);
     ASSERT(lock != NULL);
     ASSERT(!intr_context());
     ASSERT(lock_held_by_current_thread(lock));
 
-    sema_init(&waiter.semaphore, 0);
-    list_insert_ordered(&cond->waiters, &waiter.elem, sem_priority_first,
-                        NULL);  // lock acquire을 기다리는 waitlist
+    /* Queue up and release LOCK without yielding in between, so
+       that we are blocked before anyone can signal COND. */
+    old_level = intr_disable();
+    wait_queue_push(&cond->waiters, thread_current());
+    lock_release_no_yield(lock);
+    thread_block();
+    intr_set_level(old_level);
 
-    lock_release(lock);
-    sema_down(&waiter.semaphore);  // lock acquire을 기다리는 waitlist
     lock_acquire(lock);
 }
 
@@ -411,17 +593,20 @@ void cond_wait(struct condition *cond, struct lock *lock)
    interrupt handler. */
 void cond_signal(struct condition *cond, struct lock *lock)
 {
+    enum intr_level old_level;
+
     ASSERT(cond != NULL);
     ASSERT(lock != NULL);
     ASSERT(!intr_context());
     ASSERT(lock_held_by_current_thread(lock));
 
-    if (!list_empty(&cond->waiters))
+    old_level = intr_disable();
+    if (!wait_queue_empty(&cond->waiters))
     {
-        sema_up(&list_entry(list_pop_front(&cond->waiters),
-                            struct semaphore_elem, elem)
-                     ->semaphore);
+        thread_unblock(wait_queue_pop(&cond->waiters));
+        yield_to_higher_priority();
     }
+    intr_set_level(old_level);
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -435,16 +620,255 @@ void cond_broadcast(struct condition *cond, struct lock *lock)
     ASSERT(cond != NULL);
     ASSERT(lock != NULL);
 
-    while (!list_empty(&cond->waiters)) cond_signal(cond, lock);
+    while (!wait_queue_empty(&cond->waiters)) cond_signal(cond, lock);
+}
+
+/* Initializes WQ as an empty wait queue. */
+void wait_queue_init(struct wait_queue *wq)
+{
+    ASSERT(wq != NULL);
+
+    rb_init(&wq->threads, waiter_first, NULL);
+}
+
+/* Returns true if no thread is waiting in WQ. */
+bool wait_queue_empty(const struct wait_queue *wq)
+{
+    return rb_empty(&wq->threads);
+}
+
+/* Adds T to WQ, behind any waiters of the same priority.  T must
+   not be in a wait queue already.  Interrupts must be off. */
+void wait_queue_push(struct wait_queue *wq, struct thread *t)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+    ASSERT(t->wait_queue == NULL);
+
+    rb_insert(&wq->threads, &t->wait_node);
+    t->wait_queue = wq;
+}
+
+/* Removes and returns the highest-priority thread in WQ, which
+   must not be empty.  Interrupts must be off. */
+struct thread *wait_queue_pop(struct wait_queue *wq)
+{
+    struct thread *t;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+    ASSERT(!wait_queue_empty(wq));
+
+    t = rb_entry(rb_min(&wq->threads), struct thread, wait_node);
+    wait_queue_remove(t);
+    return t;
 }
 
-static bool sem_priority_first(const struct list_elem *a_,
-                               const struct list_elem *b_, void *aux)
+/* Removes T from the wait queue it is in.  Interrupts must be
+   off. */
+void wait_queue_remove(struct thread *t)
 {
-    const struct semaphore_elem *a =
-        list_entry(a_, struct semaphore_elem, elem);
-    const struct semaphore_elem *b =
-        list_entry(b_, struct semaphore_elem, elem);
+    ASSERT(intr_get_level() == INTR_OFF);
+    ASSERT(t->wait_queue != NULL);
+
+    rb_remove(&t->wait_queue->threads, &t->wait_node);
+    t->wait_queue = NULL;
+}
+
+/* Orders the donors of a lock by descending priority. */
+static bool donor_first(const struct rb_node *a_, const struct rb_node *b_,
+                        void *aux UNUSED)
+{
+    const struct thread *a = rb_entry(a_, struct thread, donor_node);
+    const struct thread *b = rb_entry(b_, struct thread, donor_node);
 
     return a->priority > b->priority;
-}
\ No newline at end of file
+}
+
+/* Orders a thread's held locks by descending donation. */
+static bool donation_first(const struct rb_node *a_,
+                           const struct rb_node *b_, void *aux UNUSED)
+{
+    const struct lock *a = rb_entry(a_, struct lock, held_node);
+    const struct lock *b = rb_entry(b_, struct lock, held_node);
+
+    return a->donation > b->donation;
+}
+
+/* Orders the threads in a wait queue by descending priority. */
+static bool waiter_first(const struct rb_node *a_, const struct rb_node *b_,
+                         void *aux UNUSED)
+{
+    const struct thread *a = rb_entry(a_, struct thread, wait_node);
+    const struct thread *b = rb_entry(b_, struct thread, wait_node);
+
+    return a->priority > b->priority;
+}
+
+/* Initializes RW as a reader-writer lock.  Any number of readers
+   may hold RW at once, or a single writer.
+
+   The lock prefers writers: once a writer has started to acquire
+   RW, readers that arrive later wait until it has released RW,
+   even though other readers are still inside.  A thread that
+   blocks behind a writer waits on RW's lock, which the writer
+   holds, so it donates its priority to the writer like any lock
+   waiter.  Readers are not tracked individually, so a writer
+   waiting for readers to leave cannot donate to them.
+
+   If lock profiling is enabled, RW's contention is charged to
+   SITE. */
+void rwlock_init_at(struct rwlock *rw, struct sync_site *site)
+{
+    ASSERT(rw != NULL);
+
+    lock_init_at(&rw->lock, site);
+    rw->readers = 0;
+    rw->writer_waiting = false;
+    sema_init_at(&rw->drained, 0, NULL);
+}
+
+/* Acquires RW for reading, sleeping while a writer holds it or is
+   waiting for it.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void rwlock_read_acquire(struct rwlock *rw)
+{
+    enum intr_level old_level;
+
+    ASSERT(rw != NULL);
+    ASSERT(!intr_context());
+
+    /* Passing through RW's lock queues us behind any writer. */
+    lock_acquire(&rw->lock);
+    old_level = intr_disable();
+    rw->readers++;
+    intr_set_level(old_level);
+    lock_release(&rw->lock);
+}
+
+/* Releases RW, which the current thread must hold for reading.
+   Lets a waiting writer in if this was the last reader. */
+void rwlock_read_release(struct rwlock *rw)
+{
+    enum intr_level old_level;
+
+    ASSERT(rw != NULL);
+
+    old_level = intr_disable();
+    ASSERT(rw->readers > 0);
+    if (--rw->readers == 0 && rw->writer_waiting)
+    {
+        rw->writer_waiting = false;
+        sema_up(&rw->drained);
+    }
+    intr_set_level(old_level);
+}
+
+/* Acquires RW for writing, sleeping until the writer or readers
+   holding it have released it.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void rwlock_write_acquire(struct rwlock *rw)
+{
+    enum intr_level old_level;
+
+    ASSERT(rw != NULL);
+    ASSERT(!intr_context());
+
+    lock_acquire(&rw->lock);
+
+    /* No new reader can get in now, so wait for the ones already
+       inside to leave. */
+    old_level = intr_disable();
+    if (rw->readers > 0)
+    {
+        rw->writer_waiting = true;
+        sema_down(&rw->drained);
+    }
+    intr_set_level(old_level);
+}
+
+/* Releases RW, which the current thread must hold for writing. */
+void rwlock_write_release(struct rwlock *rw)
+{
+    ASSERT(rw != NULL);
+    ASSERT(rw->readers == 0);
+
+    lock_release(&rw->lock);
+}
+
+/* Returns true if the current thread holds RW for writing, false
+   otherwise. */
+bool rwlock_write_held_by_current_thread(const struct rwlock *rw)
+{
+    ASSERT(rw != NULL);
+
+    return lock_held_by_current_thread(&rw->lock);
+}
+
+/* Initializes SL as a sequence lock.
+
+   Readers never block writers.  Instead, a reader samples SL's
+   sequence number before and after reading the protected data,
+   and retries if a write started or finished in between:
+
+        do
+          {
+            seq = seqlock_read_begin (&sl);
+            ...copy the data...
+          }
+        while (seqlock_read_retry (&sl, seq));
+
+   Writers run with interrupts off, which also keeps them from
+   racing each other, so write sections must be short.  Readers
+   may run in any context, including interrupt handlers. */
+void seqlock_init(struct seqlock *sl)
+{
+    ASSERT(sl != NULL);
+
+    sl->seq = 0;
+}
+
+/* Starts a read of the data protected by SL and returns the
+   sequence number to pass to seqlock_read_retry(). */
+unsigned seqlock_read_begin(const struct seqlock *sl)
+{
+    unsigned seq;
+
+    while ((seq = *(volatile const unsigned *) &sl->seq) & 1)
+        barrier();
+    barrier();
+    return seq;
+}
+
+/* Returns true if the data protected by SL may have changed since
+   the seqlock_read_begin() call that returned START, in which
+   case the read must be retried. */
+bool seqlock_read_retry(const struct seqlock *sl, unsigned start)
+{
+    barrier();
+    return *(volatile const unsigned *) &sl->seq != start;
+}
+
+/* Starts a write of the data protected by SL.  Disables
+   interrupts and returns the previous interrupt level, which must
+   be passed to seqlock_write_end(). */
+enum intr_level seqlock_write_begin(struct seqlock *sl)
+{
+    enum intr_level old_level = intr_disable();
+
+    ASSERT((sl->seq & 1) == 0);
+    sl->seq++;
+    barrier();
+    return old_level;
+}
+
+/* Finishes a write of the data protected by SL and restores the
+   interrupt level OLD_LEVEL. */
+void seqlock_write_end(struct seqlock *sl, enum intr_level old_level)
+{
+    barrier();
+    sl->seq++;
+    intr_set_level(old_level);
+}
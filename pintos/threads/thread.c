@@ -2,17 +2,23 @@
 
 #include <debug.h>
 #include <random.h>
+#include <round.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 
+#include "devices/timer.h"
 #include "intrinsic.h"
+#include "threads/fixed-point.h"
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
+#include "threads/switch.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
+#include "threads/workqueue.h"
 #include "threads/malloc.h"
 #ifdef USERPROG
 #include "userprog/process.h"
@@ -27,16 +33,24 @@
    Do not modify this value. */
 #define THREAD_BASIC 0xd42df210
 
-/* Initialize initial ticks to 0*/
-#define INIT_TICKS 0
+/* The run queue bitmap has one bit per priority level. */
+#if PRI_MIN < 0 || PRI_MAX >= 64
+#error ready_bitmap requires at most 64 priority levels
+#endif
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Run queue of processes in THREAD_READY state, that is,
+   processes that are ready to run but not actually running.
+   There is one FIFO list per priority level, and bit P of
+   ready_bitmap is set iff ready_queues[P] is nonempty, so
+   enqueueing is O(1) and finding the highest ready priority is
+   a single bit scan. */
+static struct list ready_queues[PRI_MAX + 1];
+static uint64_t ready_bitmap;
+static size_t ready_cnt; /* # of threads on the run queue. */
 
-/* List of processes in THREAD_BLOCKED state*/
-// static struct list sleep_list;
-static struct list sleep_list;
+/* List of all processes.  Processes are added to this list
+   by init_thread() and removed when they exit. */
+static struct list all_list;
 
 /* Idle thread. */
 static struct thread *idle_thread;
@@ -50,11 +64,24 @@ static struct lock tid_lock;
 /* Thread destruction requests */
 static struct list destruction_req;
 
+/* Free-thread cache.  Pages of dead threads are kept here, up to
+   THREAD_CACHE_MAX of them, instead of going back to the page
+   allocator, and thread_create() takes its page from here when
+   it can.  A cached page needs no bitmap scan, and no zeroing
+   either: init_thread() clears `struct thread' itself and the
+   stack above it needs no initial contents.  Thread pages only
+   come from the kernel pool, so one cache serves for both
+   pools. */
+#define THREAD_CACHE_MAX 16
+static struct list thread_cache;
+static size_t thread_cache_cnt;
+static long long thread_cache_hits;   /* # of pages taken from cache. */
+static long long thread_cache_misses; /* # of pages from palloc. */
+
 /* Statistics. */
 static long long idle_ticks;   /* # of timer ticks spent idle. */
 static long long kernel_ticks; /* # of timer ticks in kernel threads. */
 static long long user_ticks;   /* # of timer ticks in user programs. */
-int64_t next_to_wake_ticks = INT64_MAX; /* of timer ticks in next to wake up */
 
 /* Scheduling. */
 #define TIME_SLICE 4          /* # of timer ticks to give each thread. */
@@ -65,23 +92,130 @@ static unsigned thread_ticks; /* # of timer ticks since last yield. */
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* Multi-level feedback queue scheduler.
+
+   Only the running thread's recent_cpu is charged on each tick,
+   so between once-per-second passes only its priority can
+   change.  The pass itself updates load_avg and then recent_cpu
+   and priority of the runnable threads only.  A blocked thread
+   is brought up to date lazily when it is unblocked, by
+   replaying the decay factors of the passes it missed, which
+   are kept in decay_history[]. */
+#define MLFQS_DECAY_HISTORY 64 /* # of per-second decay factors kept. */
+static fixed_t load_avg;       /* System load average. */
+static int64_t mlfqs_seconds;  /* # of once-per-second passes so far. */
+static fixed_t decay_history[MLFQS_DECAY_HISTORY];
+
+/* MLFQS overhead statistics, in TSC cycles. */
+static long long mlfqs_tick_cnt;     /* # of ticks accounted. */
+static uint64_t mlfqs_tick_cycles;   /* Total cycles in mlfqs_tick(). */
+static long long mlfqs_pass_cnt;     /* # of once-per-second passes. */
+static uint64_t mlfqs_pass_cycles;   /* Total cycles in those passes. */
+static uint64_t mlfqs_pass_max;      /* Longest single pass. */
+
+/* If true, use the completely fair scheduler.
+   Controlled by kernel command-line option "-cfs". */
+bool thread_cfs;
+
+/* Completely fair scheduler.
+
+   Each thread's vruntime advances by the time it runs, scaled by
+   NICE_0_WEIGHT / weight, where the weight falls by about 1.25x
+   per nice level.  Ready threads are kept in a red-black tree
+   ordered by vruntime and the leftmost one runs next.  Instead
+   of a fixed TIME_SLICE, the running thread gets its weighted
+   share of a scheduling period that is CFS_LATENCY ticks long,
+   stretched to CFS_MIN_SLICE ticks per thread once there are
+   too many runnable threads to give each one that much. */
+#define CFS_NICE_0_WEIGHT 1024
+#define CFS_TICK_NS (1000000000 / TIMER_FREQ) /* ns per timer tick. */
+#define CFS_LATENCY 6                         /* Target period, in ticks. */
+#define CFS_MIN_SLICE 1                       /* Shortest slice, in ticks. */
+#define CFS_WAKEUP_GRAN CFS_TICK_NS /* vruntime lead to preempt on wakeup. */
+static struct rb_tree cfs_queue;
+static uint64_t cfs_queue_weight; /* Sum of the weights in cfs_queue. */
+static uint64_t cfs_min_vruntime; /* Monotonic floor of all vruntimes. */
+
+/* Weight of each nice level, from NICE_MIN to NICE_MAX. */
+static const uint32_t cfs_nice_weight[NICE_MAX - NICE_MIN + 1] = {
+    /* -20 */ 88761, 71755, 56483, 46273, 36291,
+    /* -15 */ 29154, 23254, 18705, 14949, 11916,
+    /* -10 */ 9548,  7620,  6100,  4904,  3906,
+    /*  -5 */ 3121,  2501,  1991,  1586,  1277,
+    /*   0 */ 1024,  820,   655,   526,   423,
+    /*   5 */ 335,   272,   215,   172,   137,
+    /*  10 */ 110,   87,    70,    56,    45,
+    /*  15 */ 36,    29,    23,    18,    15,
+    /*  20 */ 12,
+};
+
+/* Earliest-deadline-first real-time class.
+
+   Real-time threads run ahead of every other thread, whatever
+   the policy.  Those that are ready are kept in a red-black tree
+   ordered by the absolute deadline of their current job.  Each
+   job may run for at most its budget; a thread that uses it up
+   is throttled until its next release.
+
+   Admission control keeps the sum of budget/deadline over all
+   real-time threads, which under EDF is schedulable if it is at
+   most 1, below RT_BW_MAX so that normal threads are never
+   starved outright.  Bandwidth is kept in units of
+   2**-RT_BW_SHIFT. */
+#define RT_BW_SHIFT 20
+#define RT_BW_MAX ((95 << RT_BW_SHIFT) / 100) /* 95% of the CPU. */
+static struct rb_tree rt_queue;
+static uint64_t rt_bandwidth;     /* Bandwidth of admitted threads. */
+static long long rt_job_cnt;      /* # of real-time jobs completed. */
+static long long rt_miss_cnt;     /* # of them that missed deadline. */
+static long long rt_throttle_cnt; /* # of times a budget ran out. */
+
 static void kernel_thread(thread_func *, void *aux);
+static void yield(bool preempted);
 
 static void idle(void *aux UNUSED);
 static struct thread *next_thread_to_run(void);
 static void init_thread(struct thread *, const char *name, int priority);
-static void do_schedule(int status);
-static void schedule(void);
+static void do_schedule(int status, bool preempted);
+static void schedule(bool preempted);
 static tid_t allocate_tid(void);
-static bool tick_less(const struct list_elem *a_, const struct list_elem *b_,
-                      void *aux UNUSED);
+static struct thread *thread_page_alloc(void);
+static void thread_page_free(struct thread *t);
+static void sched_account(struct thread *curr, struct thread *next,
+                          bool preempted);
 bool priority_first(const struct list_elem *a_, const struct list_elem *b_,
                     void *aux);
-static bool is_higher_priority_than_current(struct thread *new_t);
+static void ready_queue_push(struct thread *t);
+static void ready_queue_remove(struct thread *t);
+static int ready_queue_max_priority(void);
+static bool ready_queue_empty(void);
+static bool is_higher_priority_than_current(int priority);
+static void mlfqs_tick(struct thread *t);
+static void mlfqs_second(void);
+static void mlfqs_catch_up(struct thread *t);
+static int mlfqs_priority(const struct thread *t);
+static void wake_sleeper(void *t_);
+static bool preempts_current(const struct thread *t);
+static bool cfs_less(const struct rb_node *a_, const struct rb_node *b_,
+                     void *aux);
+static uint32_t cfs_weight(const struct thread *t);
+static void cfs_tick(struct thread *t);
+static unsigned cfs_slice(const struct thread *t);
+static void cfs_update_min_vruntime(void);
+static bool rt_less(const struct rb_node *a_, const struct rb_node *b_,
+                    void *aux);
+static uint64_t rt_bandwidth_of(int64_t budget, int64_t deadline);
+static void rt_start_job(struct thread *t, int64_t release);
+static void rt_tick(struct thread *t);
+static void rt_release_job(void *t_);
+static void rt_leave(struct thread *t);
 
 /* Returns true if T appears to point to a valid thread. */
 #define is_thread(t) ((t) != NULL && (t)->magic == THREAD_MAGIC)
 
+/* Returns true if T is in the real-time class. */
+#define is_realtime(t) ((t)->rt_period != 0)
+
 /* Returns the running thread.
  * Read the CPU's stack pointer `rsp', and then round that
  * down to the start of a page.  Since `struct thread' is
@@ -120,9 +254,14 @@ void thread_init(void)
 
     /* Init the global thread context */
     lock_init(&tid_lock);
-    list_init(&ready_list);
-    list_init(&sleep_list);
+    for (int pri = PRI_MIN; pri <= PRI_MAX; pri++)
+        list_init(&ready_queues[pri]);
+    ready_bitmap = 0;
+    rb_init(&cfs_queue, cfs_less, NULL);
+    rb_init(&rt_queue, rt_less, NULL);
     list_init(&destruction_req);
+    list_init(&thread_cache);
+    list_init(&all_list);
 
     /* Set up a thread structure for the running thread. */
     initial_thread = running_thread();
@@ -145,14 +284,23 @@ void thread_start(void)
 
     /* Wait for the idle thread to initialize idle_thread. */
     sema_down(&idle_started);
+
+    /* Start the workqueue's worker threads. */
+    workqueue_init();
 }
 
 /* Called by the timer interrupt handler at each timer tick.
+   USER is true if the tick interrupted user-mode code.
    Thus, this function runs in an external interrupt context. */
-void thread_tick(void)
+void thread_tick(bool user)
 {
     struct thread *t = thread_current();
 
+    if (user)
+        t->sched.user_ticks++;
+    else
+        t->sched.kernel_ticks++;
+
     /* Update statistics. */
     if (t == idle_thread) idle_ticks++;
 #ifdef USERPROG
@@ -162,8 +310,15 @@ void thread_tick(void)
     else
         kernel_ticks++;
 
+    if (thread_mlfqs) mlfqs_tick(t);
+
     /* Enforce preemption. */
-    if (++thread_ticks >= TIME_SLICE) intr_yield_on_return();
+    if (is_realtime(t))
+        rt_tick(t);
+    else if (thread_cfs)
+        cfs_tick(t);
+    else if (++thread_ticks >= TIME_SLICE)
+        intr_yield_on_return();
 }
 
 /* Prints thread statistics. */
@@ -171,6 +326,29 @@ void thread_print_stats(void)
 {
     printf("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
            idle_ticks, kernel_ticks, user_ticks);
+    printf("Thread: %lld page cache hits, %lld misses\n", thread_cache_hits,
+           thread_cache_misses);
+    if (thread_mlfqs && mlfqs_tick_cnt > 0)
+        printf("MLFQS: %lld ticks, %llu cycles/tick avg; "
+               "%lld passes, %llu cycles/pass avg, %llu max\n",
+               mlfqs_tick_cnt, mlfqs_tick_cycles / mlfqs_tick_cnt,
+               mlfqs_pass_cnt,
+               mlfqs_pass_cnt > 0 ? mlfqs_pass_cycles / mlfqs_pass_cnt : 0,
+               mlfqs_pass_max);
+    if (rt_job_cnt > 0 || rt_throttle_cnt > 0)
+        printf("EDF: %lld jobs, %lld deadline misses, %lld budget overruns\n",
+               rt_job_cnt, rt_miss_cnt, rt_throttle_cnt);
+}
+
+/* Stores the number of thread pages taken from the free-thread
+   cache in *HITS and from the page allocator in *MISSES. */
+void thread_cache_stats(long long *hits, long long *misses)
+{
+    enum intr_level old_level = intr_disable();
+
+    *hits = thread_cache_hits;
+    *misses = thread_cache_misses;
+    intr_set_level(old_level);
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -197,7 +375,7 @@ tid_t thread_create(const char *name, int priority, thread_func *function,
     ASSERT(function != NULL);
 
     /* Allocate thread. */
-    t = palloc_get_page(PAL_ZERO);
+    t = thread_page_alloc();
     if (t == NULL) return TID_ERROR;
 
     /* Initialize thread. */
@@ -207,8 +385,35 @@ tid_t thread_create(const char *name, int priority, thread_func *function,
     
     tid = t->tid = allocate_tid();
 
+    /* Under the MLFQS, a new thread inherits its parent's nice
+       and recent_cpu and its priority is computed from them. */
+    if (thread_mlfqs && function != idle)
+    {
+        struct thread *parent = thread_current();
+
+        t->nice = parent->nice;
+        t->recent_cpu = parent->recent_cpu;
+        t->priority = t->origin_priority = mlfqs_priority(t);
+    }
+
+    /* Under the CFS, a new thread inherits its parent's nice and
+       starts at the queue's current minimum vruntime, so it
+       neither starves others nor is starved itself. */
+    if (thread_cfs && function != idle)
+    {
+        t->nice = thread_current()->nice;
+        t->vruntime = cfs_min_vruntime;
+    }
+
     t->fdt = calloc (20, sizeof *t->fdt);
-    if (t->fdt == NULL) return TID_ERROR;
+    if (t->fdt == NULL)
+    {
+        enum intr_level old_level = intr_disable();
+        list_remove(&t->allelem);
+        thread_page_free(t);
+        intr_set_level(old_level);
+        return TID_ERROR;
+    }
 
     // 부모 - 자식 매핑
     list_push_back(&thread_current()->child_list, &t->c_elem);
@@ -224,6 +429,15 @@ tid_t thread_create(const char *name, int priority, thread_func *function,
     t->tf.cs = SEL_KCSEG;
     t->tf.eflags = FLAG_IF;
 
+    /* The first switch_threads() into T returns to switch_entry(),
+       which starts T from T->tf. */
+    struct switch_threads_frame *sf =
+        (struct switch_threads_frame *) ((uint8_t *) t + PGSIZE) - 1;
+    memset(sf, 0, sizeof *sf);
+    sf->r12 = (uint64_t) &t->tf;
+    sf->rip = switch_entry;
+    t->switch_rsp = (uint64_t) sf;
+
     /* Add to run queue. */
     thread_unblock(t);
     yield_to_higher_priority();
@@ -242,7 +456,7 @@ void thread_block(void)
     ASSERT(!intr_context());
     ASSERT(intr_get_level() == INTR_OFF);
     thread_current()->status = THREAD_BLOCKED;
-    schedule();
+    schedule(false);
 }
 
 /* Transitions a blocked thread T to the ready-to-run state.
@@ -263,7 +477,25 @@ void thread_unblock(struct thread *t)
     ASSERT(t->status ==
            THREAD_BLOCKED);  // running_thread랑 priority를 비교함, 들어오는게
                              // 더 크면 yield 실행 아니면 insert 수행
-    list_insert_ordered(&ready_list, &t->elem, priority_first, NULL);
+    t->sched_stamp = rdtsc();
+    t->sched_woken = true;
+    if (thread_mlfqs && t->recent_cpu_epoch != mlfqs_seconds)
+    {
+        mlfqs_catch_up(t);
+        t->priority = mlfqs_priority(t);
+    }
+    if (thread_cfs)
+    {
+        /* A thread waking from a long sleep is put at most half a
+           period behind the queue minimum, so it gets a little
+           preference without being able to monopolize the CPU. */
+        uint64_t credit = CFS_LATENCY * CFS_TICK_NS / 2;
+        uint64_t floor =
+            cfs_min_vruntime > credit ? cfs_min_vruntime - credit : 0;
+
+        if (t->vruntime < floor) t->vruntime = floor;
+    }
+    ready_queue_push(t);
     t->status = THREAD_READY;
 
     // if(is_higher_priority_than_current(t) && t != idle_thread)
@@ -301,6 +533,14 @@ tid_t thread_tid(void)
     return thread_current()->tid;
 }
 
+/* Returns the running thread's tid, without thread_current()'s
+   checks, so that it may be called from inside schedule(), where
+   the running thread's status is no longer THREAD_RUNNING. */
+tid_t thread_running_tid(void)
+{
+    return running_thread()->tid;
+}
+
 /* Deschedules the current thread and destroys it.  Never
    returns to the caller. */
 void thread_exit(void)
@@ -311,10 +551,16 @@ void thread_exit(void)
     process_exit();
 #endif
 
+    intr_disable();
+
+    /* Return our real-time bandwidth and stop our release timer,
+       which lives in the page that is about to be freed. */
+    if (is_realtime(thread_current())) rt_leave(thread_current());
+    list_remove(&thread_current()->allelem);
+
     /* Just set our status to dying and schedule another process.
        We will be destroyed during the call to schedule_tail(). */
-    intr_disable();
-    do_schedule(THREAD_DYING);
+    do_schedule(THREAD_DYING, false);
     NOT_REACHED();
 }
 
@@ -323,6 +569,23 @@ void thread_exit(void)
    현재 스레드를 ready_list에 삽입하고 do_schedule을 실행
    */
 void thread_yield(void)
+{
+    yield(false);
+}
+
+/* Yields the CPU on behalf of an interrupt handler that called
+   intr_yield_on_return(), because the running thread used up its
+   time slice or must make way for another.  Unlike
+   thread_yield(), this counts as an involuntary switch. */
+void thread_preempt(void)
+{
+    yield(true);
+}
+
+/* Does the work of thread_yield() and thread_preempt().
+   PREEMPTED tells whether the thread is giving up the CPU
+   against its will. */
+static void yield(bool preempted)
 {
     struct thread *curr = thread_current();  // 현재 스레드를 가져옵니다
     enum intr_level old_level;
@@ -330,15 +593,57 @@ void thread_yield(void)
     ASSERT(!intr_context());
 
     old_level = intr_disable();  // INTR_ON로 만들고, old_level INTR_OFF
-    if (curr != idle_thread)
-        list_insert_ordered(&ready_list, &curr->elem, priority_first, NULL);
-    do_schedule(THREAD_READY);  // do_schedule
+    if (curr->rt_throttled)
+    {
+        /* Out of real-time budget: sit out until rt_release_job()
+           replenishes it. */
+        curr->rt_parked = true;
+        do_schedule(THREAD_BLOCKED, preempted);
+    }
+    else
+    {
+        if (curr != idle_thread) ready_queue_push(curr);
+        do_schedule(THREAD_READY, preempted);  // do_schedule
+    }
     intr_set_level(old_level);  // INTR_ON으로 복구함
 }
 
+/* Sets T's effective priority to PRIORITY.  If T is on the run
+   queue, it is moved to the queue for its new priority, so that
+   priority donation to a preempted lock holder takes effect
+   immediately.  Must be called with interrupts off. */
+void thread_update_priority(struct thread *t, int priority)
+{
+    ASSERT(is_thread(t));
+    ASSERT(intr_get_level() == INTR_OFF);
+    ASSERT(PRI_MIN <= priority && priority <= PRI_MAX);
+
+    if (t->priority == priority) return;
+
+    if (t->status == THREAD_READY && t != idle_thread)
+    {
+        ready_queue_remove(t);
+        t->priority = priority;
+        ready_queue_push(t);
+    }
+    else if (t->wait_queue != NULL)
+    {
+        struct wait_queue *wq = t->wait_queue;
+
+        wait_queue_remove(t);
+        t->priority = priority;
+        wait_queue_push(wq, t);
+    }
+    else
+        t->priority = priority;
+}
+
 /* Sets the current thread's priority to NEW_PRIORITY. */
 void thread_set_priority(int new_priority)
 {
+    /* The MLFQS computes priorities itself. */
+    if (thread_mlfqs) return;
+
     thread_current()->origin_priority = new_priority;
     refresh_priority();
     yield_to_higher_priority();
@@ -350,31 +655,300 @@ int thread_get_priority(void)
     return thread_current()->priority;
 }
 
-/* Sets the current thread's nice value to NICE. */
-void thread_set_nice(int nice UNUSED)
+/* Sets the current thread's nice value to NICE, recalculates
+   its priority (or under the CFS, its weight), and yields if it
+   should no longer be running. */
+void thread_set_nice(int nice)
+{
+    struct thread *cur = thread_current();
+    enum intr_level old_level;
+
+    ASSERT(NICE_MIN <= nice && nice <= NICE_MAX);
+
+    old_level = intr_disable();
+    cur->nice = nice;
+    if (thread_mlfqs) cur->priority = mlfqs_priority(cur);
+    intr_set_level(old_level);
+
+    yield_to_higher_priority();
+}
+
+/* Puts the running thread in the real-time class.  From now on
+   a job is released every PERIOD ticks, starting now; each job
+   may run for up to BUDGET ticks and should end, by calling
+   thread_wait_next_period(), within DEADLINE ticks of its
+   release.  A job that uses up its budget is throttled until the
+   next release and counts as a deadline miss.
+
+   Returns false, leaving the thread's class unchanged, if
+   admitting it would make the real-time set unschedulable. */
+bool thread_set_realtime(int64_t period, int64_t budget, int64_t deadline)
+{
+    struct thread *cur = thread_current();
+    uint64_t bw = rt_bandwidth_of(budget, deadline);
+    uint64_t avail;
+    enum intr_level old_level;
+
+    ASSERT(0 < budget && budget <= deadline && deadline <= period);
+    ASSERT(cur != idle_thread);
+
+    old_level = intr_disable();
+    avail = RT_BW_MAX - rt_bandwidth;
+    if (is_realtime(cur))
+        avail += rt_bandwidth_of(cur->rt_budget, cur->rt_deadline);
+    if (bw > avail)
+    {
+        intr_set_level(old_level);
+        return false;
+    }
+
+    if (is_realtime(cur)) rt_leave(cur);
+    rt_bandwidth += bw;
+    cur->rt_period = period;
+    cur->rt_budget = budget;
+    cur->rt_deadline = deadline;
+    cur->rt_overrun = false;
+    rt_start_job(cur, timer_ticks());
+    intr_set_level(old_level);
+
+    return true;
+}
+
+/* Returns the running thread to its normal scheduling class. */
+void thread_clear_realtime(void)
+{
+    struct thread *cur = thread_current();
+    enum intr_level old_level = intr_disable();
+
+    if (is_realtime(cur)) rt_leave(cur);
+    intr_set_level(old_level);
+
+    yield_to_higher_priority();
+}
+
+/* Ends the running real-time thread's current job and blocks it
+   until the next one is released.  If that release time has
+   already passed, the next job starts at once. */
+void thread_wait_next_period(void)
+{
+    struct thread *cur = thread_current();
+    enum intr_level old_level;
+    int64_t next;
+
+    ASSERT(is_realtime(cur));
+
+    old_level = intr_disable();
+    cur->rt_jobs++;
+    rt_job_cnt++;
+    if (cur->rt_overrun || timer_ticks() > cur->rt_abs_deadline)
+    {
+        cur->rt_misses++;
+        rt_miss_cnt++;
+    }
+    cur->rt_overrun = false;
+
+    next = cur->rt_release + cur->rt_period;
+    if (next > timer_ticks())
+    {
+        timer_event_arm(&cur->rt_timer, next);
+        cur->rt_parked = true;
+        thread_block();
+    }
+    else
+        rt_start_job(cur, next);
+    intr_set_level(old_level);
+
+    yield_to_higher_priority();
+}
+
+/* Stores the running thread's real-time statistics in STATS. */
+void thread_get_rt_stats(struct thread_rt_stats *stats)
 {
-    /* TODO: Your implementation goes here */
+    struct thread *cur = thread_current();
+    enum intr_level old_level = intr_disable();
+
+    stats->jobs = cur->rt_jobs;
+    stats->misses = cur->rt_misses;
+    stats->throttles = cur->rt_throttles;
+    intr_set_level(old_level);
+}
+
+/* Copies the scheduling statistics of the thread with the given
+   TID into STATS.  Returns false if there is no such thread. */
+bool thread_get_sched_stats(tid_t tid, struct sched_stats *stats)
+{
+    enum intr_level old_level = intr_disable();
+    bool found = false;
+
+    for (struct list_elem *e = list_begin(&all_list); e != list_end(&all_list);
+         e = list_next(e))
+    {
+        struct thread *t = list_entry(e, struct thread, allelem);
+
+        if (t->tid == tid)
+        {
+            *stats = t->sched;
+            if (t == thread_current())
+                stats->run_cycles += rdtsc() - t->sched_stamp;
+            found = true;
+            break;
+        }
+    }
+    intr_set_level(old_level);
+
+    return found;
 }
 
 /* Returns the current thread's nice value. */
 int thread_get_nice(void)
 {
-    /* TODO: Your implementation goes here */
-    return 0;
+    return thread_current()->nice;
 }
 
 /* Returns 100 times the system load average. */
 int thread_get_load_avg(void)
 {
-    /* TODO: Your implementation goes here */
-    return 0;
+    enum intr_level old_level = intr_disable();
+    int load_avg_100 = fp_to_int_round(fp_mul_int(load_avg, 100));
+    intr_set_level(old_level);
+
+    return load_avg_100;
 }
 
 /* Returns 100 times the current thread's recent_cpu value. */
 int thread_get_recent_cpu(void)
 {
-    /* TODO: Your implementation goes here */
-    return 0;
+    enum intr_level old_level = intr_disable();
+    int recent_cpu_100 =
+        fp_to_int_round(fp_mul_int(thread_current()->recent_cpu, 100));
+    intr_set_level(old_level);
+
+    return recent_cpu_100;
+}
+
+/* MLFQS work for one timer tick, run from thread_tick() on
+   behalf of the running thread T. */
+static void mlfqs_tick(struct thread *t)
+{
+    uint64_t start = rdtsc();
+    int64_t now = timer_ticks();
+    bool recomputed = false;
+
+    if (t != idle_thread) t->recent_cpu = fp_add_int(t->recent_cpu, 1);
+
+    if (now % TIMER_FREQ == 0)
+    {
+        mlfqs_second();
+        recomputed = true;
+
+        uint64_t cycles = rdtsc() - start;
+        mlfqs_pass_cnt++;
+        mlfqs_pass_cycles += cycles;
+        if (cycles > mlfqs_pass_max) mlfqs_pass_max = cycles;
+    }
+    else if (now % TIME_SLICE == 0 && t != idle_thread)
+    {
+        /* Nobody else's recent_cpu or nice changed since the last
+           pass, so only the running thread needs a new priority. */
+        t->priority = mlfqs_priority(t);
+        recomputed = true;
+    }
+
+    if (recomputed &&
+        is_higher_priority_than_current(ready_queue_max_priority()))
+        intr_yield_on_return();
+
+    mlfqs_tick_cnt++;
+    mlfqs_tick_cycles += rdtsc() - start;
+}
+
+/* Once-per-second MLFQS pass: updates load_avg, then decays
+   recent_cpu and recomputes the priority of every runnable
+   thread.  Costs O(runnable threads). */
+static void mlfqs_second(void)
+{
+    struct thread *cur = thread_current();
+    int ready_threads = ready_cnt + (cur != idle_thread ? 1 : 0);
+    struct list batch;
+
+    load_avg = fp_add(fp_mul(fp_div_int(fp_from_int(59), 60), load_avg),
+                      fp_div_int(fp_from_int(ready_threads), 60));
+
+    fixed_t twice_load = fp_mul_int(load_avg, 2);
+    mlfqs_seconds++;
+    decay_history[mlfqs_seconds % MLFQS_DECAY_HISTORY] =
+        fp_div(twice_load, fp_add_int(twice_load, 1));
+
+    /* Pull every ready thread off the run queue, then requeue each
+       one under its new priority. */
+    list_init(&batch);
+    for (int pri = PRI_MAX; pri >= PRI_MIN; pri--)
+        if (!list_empty(&ready_queues[pri]))
+            list_splice(list_end(&batch), list_begin(&ready_queues[pri]),
+                        list_end(&ready_queues[pri]));
+    ready_bitmap = 0;
+    ready_cnt = 0;
+
+    while (!list_empty(&batch))
+    {
+        struct thread *t =
+            list_entry(list_pop_front(&batch), struct thread, elem);
+
+        mlfqs_catch_up(t);
+        t->priority = mlfqs_priority(t);
+        ready_queue_push(t);
+    }
+
+    if (cur != idle_thread)
+    {
+        mlfqs_catch_up(cur);
+        cur->priority = mlfqs_priority(cur);
+    }
+}
+
+/* Applies to T the recent_cpu decay of every once-per-second pass
+   since T was last brought up to date.  Runnable threads are
+   updated by every pass, so this only loops for threads that
+   were blocked across several passes. */
+static void mlfqs_catch_up(struct thread *t)
+{
+    int64_t first = t->recent_cpu_epoch + 1;
+    int64_t oldest = mlfqs_seconds - MLFQS_DECAY_HISTORY + 1;
+
+    if (first < oldest)
+    {
+        /* The decay factors of these passes have been overwritten.
+           recent_cpu converges geometrically, so a bounded number of
+           steps with the oldest factor still known is close enough. */
+        fixed_t decay = decay_history[oldest % MLFQS_DECAY_HISTORY];
+        int64_t steps = oldest - first < MLFQS_DECAY_HISTORY
+                            ? oldest - first
+                            : MLFQS_DECAY_HISTORY;
+
+        while (steps-- > 0)
+            t->recent_cpu =
+                fp_add_int(fp_mul(decay, t->recent_cpu), t->nice);
+        first = oldest;
+    }
+
+    for (int64_t sec = first; sec <= mlfqs_seconds; sec++)
+        t->recent_cpu = fp_add_int(
+            fp_mul(decay_history[sec % MLFQS_DECAY_HISTORY], t->recent_cpu),
+            t->nice);
+    t->recent_cpu_epoch = mlfqs_seconds;
+}
+
+/* Returns T's MLFQS priority,
+   PRI_MAX - (recent_cpu / 4) - (nice * 2), clamped to
+   [PRI_MIN, PRI_MAX]. */
+static int mlfqs_priority(const struct thread *t)
+{
+    int priority =
+        PRI_MAX - fp_to_int(fp_div_int(t->recent_cpu, 4)) - t->nice * 2;
+
+    if (priority < PRI_MIN) return PRI_MIN;
+    if (priority > PRI_MAX) return PRI_MAX;
+    return priority;
 }
 
 /* Idle thread.  Executes when no other thread is ready to run.
@@ -395,6 +969,10 @@ static void idle(void *idle_started_ UNUSED)
 
     for (;;)
     {
+        /* Zero free pages ahead of PAL_ZERO requests, one at a time,
+           for as long as no other thread wants the CPU. */
+        while (ready_queue_empty() && palloc_zero_idle()) continue;
+
         /* Let someone else run. */
         intr_disable();
         thread_block();
@@ -410,7 +988,12 @@ static void idle(void *idle_started_ UNUSED)
            time.
 
            See [IA32-v2a] "HLT", [IA32-v2b] "STI", and [IA32-v3a]
-           7.11.1 "HLT Instruction". */
+           7.11.1 "HLT Instruction".
+
+           Before halting, stop the periodic tick if no timer event
+           is due soon; the next interrupt restarts it. */
+        timer_tickless_enter();
+        intr_irqsoff_sti();
         asm volatile("sti; hlt" : : : "memory");
     }
 }
@@ -425,33 +1008,59 @@ static void kernel_thread(thread_func *function, void *aux)
     thread_exit(); /* If function() returns, kill the thread. */
 }
 
-/* Function used as changing status THREAD_RUNNING to THREAD_BLCOKED
- *
- */
-void thread_sleep(int64_t ticks)
+/* Blocks the running thread until timer_ticks() reaches
+   WAKE_TICKS, using a timer event that lives on its stack. */
+void thread_sleep(int64_t wake_ticks)
 {
-    enum intr_level old_level = intr_disable();
     struct thread *curr = thread_current();
+    struct timer_event wakeup;
+    enum intr_level old_level;
 
-    if (curr != idle_thread)
-    {
-        curr->sleep_ticks = ticks;
-        // list_insert_ordered(&sleep_list, &curr->elem, tick_less, NULL);
-        list_insert_ordered(&sleep_list, &curr->elem, priority_first, NULL);
+    if (curr == idle_thread) return;
 
-        if (next_to_wake_ticks > ticks)
-            next_to_wake_ticks = ticks;  // TODO : initialize next_to_wake_ticks
-                                         // where proper location
+    timer_event_init(&wakeup, wake_sleeper, curr);
 
-        do_schedule(THREAD_BLOCKED);
-    }
+    old_level = intr_disable();
+    timer_event_arm(&wakeup, wake_ticks);
+    thread_block();
     intr_set_level(old_level);
 }
 
+/* Puts the current thread to sleep until timer_ns() reaches
+   WAKE_NS, using a high-resolution timer. */
+void thread_hrsleep(int64_t wake_ns)
+{
+    struct thread *curr = thread_current();
+    struct hrtimer wakeup;
+    enum intr_level old_level;
+
+    if (curr == idle_thread) return;
+
+    hrtimer_init(&wakeup, wake_sleeper, curr);
+
+    old_level = intr_disable();
+    hrtimer_arm(&wakeup, wake_ns);
+    thread_block();
+    intr_set_level(old_level);
+}
+
+/* Timer event callback for thread_sleep() and thread_hrsleep():
+   moves sleeping thread T_ to the run queue, preempting the
+   interrupted thread if T_ should run before it. */
+static void wake_sleeper(void *t_)
+{
+    struct thread *t = t_;
+
+    thread_unblock(t);
+    if (intr_context() && preempts_current(t)) intr_yield_on_return();
+}
+
 /* Does basic initialization of T as a blocked thread named
    NAME. */
 static void init_thread(struct thread *t, const char *name, int priority)
 {
+    enum intr_level old_level;
+
     ASSERT(t != NULL);
     ASSERT(PRI_MIN <= priority && priority <= PRI_MAX);
     ASSERT(name != NULL);
@@ -462,13 +1071,21 @@ static void init_thread(struct thread *t, const char *name, int priority)
     t->tf.rsp = (uint64_t) t + PGSIZE - sizeof(void *);
     t->priority = priority;
     t->magic = THREAD_MAGIC;
-    t->sleep_ticks = INIT_TICKS;
+    t->sched_stamp = rdtsc();
+    t->nice = NICE_DEFAULT;
+    t->recent_cpu = 0;
+    t->recent_cpu_epoch = mlfqs_seconds;
+    timer_event_init(&t->rt_timer, rt_release_job, t);
+
+    old_level = intr_disable();
+    list_push_back(&all_list, &t->allelem);
+    intr_set_level(old_level);
 
     /* Initialize the thread's original priority for donation. */
 
     t->origin_priority = priority;
     t->wait_on_lock = NULL;
-    list_init(&t->donor_list);
+    lock_donation_init(t);
 
     // for(int i =3;i<128;i++){
     //     t->fdt[i] = NULL;
@@ -496,10 +1113,106 @@ static void init_thread(struct thread *t, const char *name, int priority)
    idle_thread. */
 static struct thread *next_thread_to_run(void)
 {
-    if (list_empty(&ready_list))
-        return idle_thread;
-    else
-        return list_entry(list_pop_front(&ready_list), struct thread, elem);
+    struct rb_node *rt_node = rb_min(&rt_queue);
+
+    if (rt_node != NULL)
+    {
+        struct thread *t = rb_entry(rt_node, struct thread, rt_node);
+
+        ready_queue_remove(t);
+        return t;
+    }
+
+    if (thread_cfs)
+    {
+        struct rb_node *node = rb_min(&cfs_queue);
+        struct thread *t;
+
+        if (node == NULL) return idle_thread;
+        t = rb_entry(node, struct thread, cfs_node);
+        ready_queue_remove(t);
+        return t;
+    }
+
+    if (ready_bitmap == 0) return idle_thread;
+
+    struct list *queue = &ready_queues[ready_queue_max_priority()];
+    struct thread *t = list_entry(list_front(queue), struct thread, elem);
+    ready_queue_remove(t);
+    return t;
+}
+
+/* Appends T to the tail of the run queue for its priority, or
+   inserts it into the tree by deadline if it is a real-time
+   thread or by vruntime under the CFS. */
+static void ready_queue_push(struct thread *t)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (is_realtime(t))
+    {
+        rb_insert(&rt_queue, &t->rt_node);
+        ready_cnt++;
+        return;
+    }
+
+    if (thread_cfs)
+    {
+        rb_insert(&cfs_queue, &t->cfs_node);
+        cfs_queue_weight += cfs_weight(t);
+        ready_cnt++;
+        return;
+    }
+
+    list_push_back(&ready_queues[t->priority], &t->elem);
+    ready_bitmap |= 1ULL << t->priority;
+    ready_cnt++;
+}
+
+/* Removes T from the run queue. */
+static void ready_queue_remove(struct thread *t)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (is_realtime(t))
+    {
+        rb_remove(&rt_queue, &t->rt_node);
+        ready_cnt--;
+        return;
+    }
+
+    if (thread_cfs)
+    {
+        rb_remove(&cfs_queue, &t->cfs_node);
+        cfs_queue_weight -= cfs_weight(t);
+        ready_cnt--;
+        return;
+    }
+
+    list_remove(&t->elem);
+    ready_cnt--;
+    if (list_empty(&ready_queues[t->priority]))
+        ready_bitmap &= ~(1ULL << t->priority);
+}
+
+/* Returns the highest priority that has a ready thread, or -1
+   if the run queue is empty. */
+static int ready_queue_max_priority(void)
+{
+    uint64_t bitmap = ready_bitmap;
+
+    return bitmap == 0 ? -1 : 63 - __builtin_clzll(bitmap);
+}
+
+/* Returns true if no thread is waiting to run.  The idle thread
+   calls this with interrupts on, so the answer may be stale by the
+   time it returns; that only delays a woken thread by one step of
+   the idle loop. */
+static bool ready_queue_empty(void)
+{
+    if (rb_min(&rt_queue) != NULL) return false;
+    if (thread_cfs) return rb_min(&cfs_queue) == NULL;
+    return ready_bitmap == 0;
 }
 
 /* Use iretq to launch the thread */
@@ -532,74 +1245,20 @@ void do_iret(struct intr_frame *tf)
         : "memory");
 }
 
-/* Switching the thread by activating the new thread's page
-   tables, and, if the previous thread is dying, destroying it.
+/* Switches from the running thread to TH, whose address space
+   has already been activated.
 
-   At this function's invocation, we just switched from thread
-   PREV, the new thread is already running, and interrupts are
-   still disabled.
-
-   It's not safe to call printf() until the thread switch is
-   complete.  In practice that means that printf()s should be
-   added at the end of the function. */
+   Threads are only ever switched out from inside schedule(), so
+   saving the callee-saved registers is enough; switch_threads()
+   returns in TH wherever TH last called it.  A thread that has
+   never run is instead launched from its intr_frame by
+   switch_entry(), so the full iretq path is only taken on a
+   thread's first run and on return to user mode. */
 static void thread_launch(struct thread *th)
 {
-    uint64_t tf_cur = (uint64_t) &running_thread()->tf;
-    uint64_t tf = (uint64_t) &th->tf;
     ASSERT(intr_get_level() == INTR_OFF);
 
-    /* The main switching logic.
-     * We first restore the whole execution context into the intr_frame
-     * and then switching to the next thread by calling do_iret.
-     * Note that, we SHOULD NOT use any stack from here
-     * until switching is done. */
-    __asm __volatile(
-        /* Store registers that will be used. */
-        "push %%rax\n"
-        "push %%rbx\n"
-        "push %%rcx\n"
-        /* Fetch input once */
-        "movq %0, %%rax\n"
-        "movq %1, %%rcx\n"
-        "movq %%r15, 0(%%rax)\n"
-        "movq %%r14, 8(%%rax)\n"
-        "movq %%r13, 16(%%rax)\n"
-        "movq %%r12, 24(%%rax)\n"
-        "movq %%r11, 32(%%rax)\n"
-        "movq %%r10, 40(%%rax)\n"
-        "movq %%r9, 48(%%rax)\n"
-        "movq %%r8, 56(%%rax)\n"
-        "movq %%rsi, 64(%%rax)\n"
-        "movq %%rdi, 72(%%rax)\n"
-        "movq %%rbp, 80(%%rax)\n"
-        "movq %%rdx, 88(%%rax)\n"
-        "pop %%rbx\n"  // Saved rcx
-        "movq %%rbx, 96(%%rax)\n"
-        "pop %%rbx\n"  // Saved rbx
-        "movq %%rbx, 104(%%rax)\n"
-        "pop %%rbx\n"  // Saved rax
-        "movq %%rbx, 112(%%rax)\n"
-        "addq $120, %%rax\n"
-        "movw %%es, (%%rax)\n"
-        "movw %%ds, 8(%%rax)\n"
-        "addq $32, %%rax\n"
-        "call __next\n"  // read the current rip.
-        "__next:\n"
-        "pop %%rbx\n"
-        "addq $(out_iret -  __next), %%rbx\n"
-        "movq %%rbx, 0(%%rax)\n"  // rip
-        "movw %%cs, 8(%%rax)\n"   // cs
-        "pushfq\n"
-        "popq %%rbx\n"
-        "mov %%rbx, 16(%%rax)\n"  // eflags
-        "mov %%rsp, 24(%%rax)\n"  // rsp
-        "movw %%ss, 32(%%rax)\n"
-        "mov %%rcx, %%rdi\n"
-        "call do_iret\n"
-        "out_iret:\n"
-        :
-        : "g"(tf_cur), "g"(tf)
-        : "memory");
+    switch_threads(&running_thread()->switch_rsp, th->switch_rsp);
 }
 
 /* Schedules a new process. At entry, interrupts must be off.
@@ -608,7 +1267,7 @@ static void thread_launch(struct thread *th)
  * It's not safe to call printf() in the schedule().
  * 현재 스레드의 status를 변경함, 이후 다른 스레드로 교체(schedule)한다
  * */
-static void do_schedule(int status)
+static void do_schedule(int status, bool preempted)
 {
     ASSERT(intr_get_level() == INTR_OFF);
     ASSERT(thread_current()->status == THREAD_RUNNING);
@@ -616,13 +1275,16 @@ static void do_schedule(int status)
     {
         struct thread *victim =
             list_entry(list_pop_front(&destruction_req), struct thread, elem);
-        palloc_free_page(victim);
+        thread_page_free(victim);
     }
     thread_current()->status = status;
-    schedule();
+    schedule(preempted);
 }
 
-static void schedule(void)
+/* Switches to the next thread to run.  PREEMPTED tells whether
+   the running thread is being switched out against its will,
+   for the scheduling statistics. */
+static void schedule(bool preempted)
 {  // 현재 스레드를 가져옴, 다음에 실행될 스레드를 가져옴(RUNNING으로 전환)
     struct thread *curr = running_thread();
     struct thread *next = next_thread_to_run();
@@ -630,6 +1292,11 @@ static void schedule(void)
     ASSERT(intr_get_level() == INTR_OFF);
     ASSERT(curr->status != THREAD_RUNNING);
     ASSERT(is_thread(next));
+
+    sched_account(curr, next, preempted);
+    TRACE(TRACE_SCHED_SWITCH, curr->tid, next->tid, curr->status,
+          next->priority);
+
     /* Mark us as running. */
     next->status = THREAD_RUNNING;
 
@@ -662,6 +1329,77 @@ static void schedule(void)
     }
 }
 
+/* Updates the scheduling statistics of CURR, which is giving up
+   the CPU, and NEXT, which is about to get it.  The switch is
+   involuntary if CURR was PREEMPTED, and voluntary if it blocked,
+   exited or yielded of its own accord. */
+static void sched_account(struct thread *curr, struct thread *next,
+                          bool preempted)
+{
+    uint64_t now = rdtsc();
+
+    curr->sched.run_cycles += now - curr->sched_stamp;
+    curr->sched_stamp = now;
+
+    if (next != curr)
+    {
+        uint64_t wait = now - next->sched_stamp;
+
+        if (preempted)
+            curr->sched.involuntary_switches++;
+        else
+            curr->sched.voluntary_switches++;
+
+        next->sched.wait_cycles += wait;
+        next->sched_stamp = now;
+        if (next->sched_woken)
+        {
+            int bucket = wait > 1 ? 63 - __builtin_clzll(wait) : 0;
+
+            if (bucket >= SCHED_LATENCY_BUCKETS)
+                bucket = SCHED_LATENCY_BUCKETS - 1;
+            next->sched.latency[bucket]++;
+            next->sched_woken = false;
+        }
+    }
+}
+
+/* Returns a page for a new thread, from the free-thread cache if
+   it has one, or a null pointer if memory is exhausted. */
+static struct thread *thread_page_alloc(void)
+{
+    struct thread *t = NULL;
+    enum intr_level old_level = intr_disable();
+
+    if (!list_empty(&thread_cache))
+    {
+        t = list_entry(list_pop_front(&thread_cache), struct thread, elem);
+        thread_cache_cnt--;
+        thread_cache_hits++;
+    }
+    else
+        thread_cache_misses++;
+    intr_set_level(old_level);
+
+    return t != NULL ? t : palloc_get_page(0);
+}
+
+/* Returns dead thread T's page to the free-thread cache, or to
+   the page allocator if the cache is full.  Must be called with
+   interrupts off. */
+static void thread_page_free(struct thread *t)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (thread_cache_cnt < THREAD_CACHE_MAX)
+    {
+        list_push_front(&thread_cache, &t->elem);
+        thread_cache_cnt++;
+    }
+    else
+        palloc_free_page(t);
+}
+
 /* Returns a tid to use for a new thread. */
 static tid_t allocate_tid(void)
 {
@@ -675,15 +1413,6 @@ static tid_t allocate_tid(void)
     return tid;
 }
 
-/* Returns true if ticks A is less than ticks B, false otherwise.*/
-static bool tick_less(const struct list_elem *a_, const struct list_elem *b_,
-                      void *aux UNUSED)
-{
-    const struct thread *a = list_entry(a_, struct thread, elem);
-    const struct thread *b = list_entry(b_, struct thread, elem);
-
-    return a->sleep_ticks < b->sleep_ticks;
-}
 bool priority_first(const struct list_elem *a_, const struct list_elem *b_,
                     void *aux)
 {
@@ -693,43 +1422,208 @@ bool priority_first(const struct list_elem *a_, const struct list_elem *b_,
     return a->priority > b->priority;
 }
 
-/* move the thread from the sleep_list to the ready_list */
-void wake_up(int64_t cur_ticks)
+static bool is_higher_priority_than_current(int priority)
 {
-    enum intr_level old_level = intr_disable();
-    struct list_elem *e = list_begin(&sleep_list);
+    return priority > thread_current()->priority;
+}
+
+/* Returns true if ready thread T should preempt the running
+   thread: if T is real-time and the running thread is not or
+   has a later deadline; under the CFS, if T's vruntime trails
+   the running thread's by more than the wakeup granularity; and
+   otherwise if T has a higher priority. */
+static bool preempts_current(const struct thread *t)
+{
+    struct thread *cur = thread_current();
+
+    if (is_realtime(t))
+        return !is_realtime(cur) || t->rt_abs_deadline < cur->rt_abs_deadline;
+    if (is_realtime(cur)) return false;
+    if (!thread_cfs) return is_higher_priority_than_current(t->priority);
+    if (cur == idle_thread) return true;
+    return t->vruntime + CFS_WAKEUP_GRAN < cur->vruntime;
+}
 
-    while (e != list_end(&sleep_list))
+/* Yields the CPU if a ready thread should run before the running
+   thread, as decided by preempts_current(). */
+void yield_to_higher_priority(void)
+{
+    struct rb_node *rt_node = rb_min(&rt_queue);
+
+    if (rt_node != NULL)
     {
-        struct thread *curr = list_entry(e, struct thread, elem);
+        /* A ready real-time thread outranks every normal one. */
+        if (preempts_current(rb_entry(rt_node, struct thread, rt_node)))
+            thread_yield();
+    }
+    else if (thread_cfs)
+    {
+        struct rb_node *node = rb_min(&cfs_queue);
 
-        if (curr->sleep_ticks <= cur_ticks)
-        {
-            e = list_remove(e);
-            thread_unblock(curr);
-        }
-        else
-        {
-            e = e->next;
-            // break;
-        }
+        if (node != NULL &&
+            preempts_current(rb_entry(node, struct thread, cfs_node)))
+            thread_yield();
     }
+    else if (is_higher_priority_than_current(ready_queue_max_priority()))
+        thread_yield();
+}
 
-    intr_set_level(old_level);
+/* Orders threads in the CFS run queue by ascending vruntime. */
+static bool cfs_less(const struct rb_node *a_, const struct rb_node *b_,
+                     void *aux UNUSED)
+{
+    const struct thread *a = rb_entry(a_, struct thread, cfs_node);
+    const struct thread *b = rb_entry(b_, struct thread, cfs_node);
+
+    return a->vruntime < b->vruntime;
 }
 
-static bool is_higher_priority_than_current(struct thread *new_t)
+/* Returns T's CFS load weight, which depends on its nice. */
+static uint32_t cfs_weight(const struct thread *t)
 {
-    return new_t->priority > thread_current()->priority;
+    return cfs_nice_weight[t->nice - NICE_MIN];
 }
 
-void yield_to_higher_priority(void)
+/* CFS work for one timer tick, run from thread_tick() on behalf
+   of the running thread T: charges T for the tick and preempts
+   it once it has used up its slice, or once it has run far
+   enough ahead of the leftmost ready thread. */
+static void cfs_tick(struct thread *t)
+{
+    struct rb_node *node = rb_min(&cfs_queue);
+    unsigned slice;
+
+    thread_ticks++;
+    if (t == idle_thread)
+    {
+        if (node != NULL) intr_yield_on_return();
+        return;
+    }
+
+    t->vruntime += (uint64_t) CFS_TICK_NS * CFS_NICE_0_WEIGHT / cfs_weight(t);
+    cfs_update_min_vruntime();
+
+    slice = cfs_slice(t);
+    if (thread_ticks >= slice)
+        intr_yield_on_return();
+    else if (node != NULL)
+    {
+        const struct thread *next = rb_entry(node, struct thread, cfs_node);
+
+        if (t->vruntime > next->vruntime + (uint64_t) slice * CFS_TICK_NS)
+            intr_yield_on_return();
+    }
+}
+
+/* Returns the length, in ticks, of running thread T's time
+   slice: its weighted share of a period of CFS_LATENCY ticks,
+   or of CFS_MIN_SLICE ticks per runnable thread if that is
+   longer. */
+static unsigned cfs_slice(const struct thread *t)
 {
-    if (!list_empty(&ready_list))
+    uint64_t runnable = ready_cnt + 1;
+    uint64_t period = runnable * CFS_MIN_SLICE > CFS_LATENCY
+                          ? runnable * CFS_MIN_SLICE
+                          : CFS_LATENCY;
+    uint64_t weight = cfs_weight(t);
+    uint64_t slice = period * weight / (cfs_queue_weight + weight);
+
+    return slice > CFS_MIN_SLICE ? slice : CFS_MIN_SLICE;
+}
+
+/* Advances cfs_min_vruntime to the least vruntime among the
+   running thread and the ready threads.  It never goes
+   backward, so threads that slept or were just created can be
+   placed relative to it. */
+static void cfs_update_min_vruntime(void)
+{
+    struct thread *cur = thread_current();
+    struct rb_node *node = rb_min(&cfs_queue);
+    uint64_t vruntime = cur->vruntime;
+
+    if (node != NULL)
     {
-        struct thread *begin =
-            list_entry(list_begin(&ready_list), struct thread, elem);
+        uint64_t left = rb_entry(node, struct thread, cfs_node)->vruntime;
+
+        if (cur == idle_thread || left < vruntime) vruntime = left;
+    }
+    else if (cur == idle_thread)
+        return;
+
+    if (vruntime > cfs_min_vruntime) cfs_min_vruntime = vruntime;
+}
+
+/* Orders threads in the EDF run queue by ascending deadline. */
+static bool rt_less(const struct rb_node *a_, const struct rb_node *b_,
+                    void *aux UNUSED)
+{
+    const struct thread *a = rb_entry(a_, struct thread, rt_node);
+    const struct thread *b = rb_entry(b_, struct thread, rt_node);
+
+    return a->rt_abs_deadline < b->rt_abs_deadline;
+}
+
+/* Returns the share of the CPU that a thread with the given
+   BUDGET and DEADLINE may need, rounded up. */
+static uint64_t rt_bandwidth_of(int64_t budget, int64_t deadline)
+{
+    return DIV_ROUND_UP((uint64_t) budget << RT_BW_SHIFT, deadline);
+}
 
-        if (is_higher_priority_than_current(begin)) thread_yield();
+/* Starts a new job of real-time thread T, released at RELEASE,
+   with a full budget. */
+static void rt_start_job(struct thread *t, int64_t release)
+{
+    t->rt_release = release;
+    t->rt_abs_deadline = release + t->rt_deadline;
+    t->rt_remaining = t->rt_budget;
+    t->rt_throttled = false;
+}
+
+/* Real-time work for one timer tick, run from thread_tick() on
+   behalf of the running real-time thread T: charges the tick to
+   T's budget and throttles T once the budget is gone.  Real-time
+   threads are not otherwise time-sliced. */
+static void rt_tick(struct thread *t)
+{
+    if (--t->rt_remaining > 0) return;
+
+    t->rt_throttled = true;
+    t->rt_overrun = true;
+    t->rt_throttles++;
+    rt_throttle_cnt++;
+
+    /* If the next release is already due, the timer fires in this
+       same interrupt and T keeps running with a fresh budget. */
+    timer_event_arm(&t->rt_timer, t->rt_release + t->rt_period);
+    intr_yield_on_return();
+}
+
+/* Timer event callback: releases the next job of real-time
+   thread T_, waking it if it was waiting for the release or
+   throttled, and preempting the interrupted thread if T_'s new
+   deadline is earlier. */
+static void rt_release_job(void *t_)
+{
+    struct thread *t = t_;
+
+    rt_start_job(t, t->rt_release + t->rt_period);
+    if (t->rt_parked)
+    {
+        t->rt_parked = false;
+        thread_unblock(t);
+        if (intr_context() && preempts_current(t)) intr_yield_on_return();
     }
-}
\ No newline at end of file
+}
+
+/* Takes T, which must be running, out of the real-time class.
+   Must be called with interrupts off. */
+static void rt_leave(struct thread *t)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    timer_event_cancel(&t->rt_timer);
+    rt_bandwidth -= rt_bandwidth_of(t->rt_budget, t->rt_deadline);
+    t->rt_period = 0;
+    t->rt_throttled = false;
+}
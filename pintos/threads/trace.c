@@ -0,0 +1,120 @@
+#include "threads/trace.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Static tracepoints.
+
+   A tracepoint is a TRACE() call at an interesting place in the
+   kernel.  When tracing is enabled, it records a fixed-size
+   binary event: a timestamp, the running thread, the event's
+   identifier and up to four arguments.  Events go into a ring
+   buffer allocated once at boot, so recording one never takes a
+   lock, never allocates and never touches the console, and the
+   oldest events are overwritten once the ring is full.
+
+   There is only one CPU, so the only concurrent writer is an
+   interrupt handler that runs in the middle of another event.
+   Each writer claims its slot with a single atomic increment of
+   the ring's head before filling it in, so nested writers never
+   share a slot.
+
+   At power off, trace_dump() prints the ring to the console,
+   from which utils/trace-report decodes it. */
+
+/* One recorded event. */
+struct trace_event
+  {
+    int64_t ns;                 /* timer_ns() when recorded. */
+    int32_t tid;                /* Running thread. */
+    uint16_t id;                /* An enum trace_id. */
+    uint16_t pad;
+    uint64_t args[4];           /* Event arguments. */
+  };
+
+/* Event names, followed by the names of their arguments. */
+static const char *const trace_formats[TRACE_CNT] =
+  {
+    [TRACE_SCHED_SWITCH] = "sched_switch prev next prev_status next_priority",
+    [TRACE_SYSCALL] = "syscall nr arg0 arg1 arg2",
+    [TRACE_SYSCALL_DONE] = "syscall_done nr ret",
+    [TRACE_PAGE_FAULT] = "page_fault addr user write not_present",
+    [TRACE_PAGE_FAULT_DONE] = "page_fault_done addr handled",
+    [TRACE_DISK_READ] = "disk_read chan_no dev_no sector",
+    [TRACE_DISK_READ_DONE] = "disk_read_done chan_no dev_no sector",
+    [TRACE_DISK_WRITE] = "disk_write chan_no dev_no sector",
+    [TRACE_DISK_WRITE_DONE] = "disk_write_done chan_no dev_no sector",
+  };
+
+unsigned trace_pages;
+bool trace_enabled;
+
+static struct trace_event *ring;        /* Ring buffer. */
+static size_t ring_size;                /* Capacity, in events. */
+static uint64_t ring_head;              /* Events ever claimed. */
+
+/* Allocates the ring buffer and starts recording events, if
+   -trace was given. */
+void
+trace_init (void)
+{
+  if (trace_pages == 0)
+    return;
+
+  ring = palloc_get_multiple (PAL_ASSERT | PAL_ZERO, trace_pages);
+  ring_size = trace_pages * PGSIZE / sizeof *ring;
+  trace_enabled = true;
+}
+
+/* Records event ID with arguments ARGS. */
+void
+trace_emit (enum trace_id id, const uint64_t args[4])
+{
+  uint64_t slot = __atomic_fetch_add (&ring_head, 1, __ATOMIC_RELAXED);
+  struct trace_event *e = &ring[slot % ring_size];
+
+  ASSERT (id < TRACE_CNT);
+
+  e->ns = timer_ns ();
+  e->tid = thread_running_tid ();
+  e->id = id;
+  e->args[0] = args[0];
+  e->args[1] = args[1];
+  e->args[2] = args[2];
+  e->args[3] = args[3];
+}
+
+/* Stops recording and prints the event formats, then the events
+   in the ring from oldest to newest, one per line. */
+void
+trace_dump (void)
+{
+  enum intr_level old_level;
+  uint64_t first, i;
+  int id;
+
+  if (!trace_enabled)
+    return;
+
+  old_level = intr_disable ();
+  trace_enabled = false;
+  intr_set_level (old_level);
+
+  first = ring_head > ring_size ? ring_head - ring_size : 0;
+  printf ("Trace: %"PRIu64" events, %"PRIu64" overwritten\n",
+          ring_head - first, first);
+  for (id = 0; id < TRACE_CNT; id++)
+    printf ("Trace: event %d %s\n", id, trace_formats[id]);
+  for (i = first; i < ring_head; i++)
+    {
+      const struct trace_event *e = &ring[i % ring_size];
+      printf ("Trace: %"PRId64" %"PRId32" %"PRIu16" %#"PRIx64" %#"PRIx64
+              " %#"PRIx64" %#"PRIx64"\n", e->ns, e->tid, e->id,
+              e->args[0], e->args[1], e->args[2], e->args[3]);
+    }
+}
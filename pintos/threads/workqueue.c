@@ -0,0 +1,260 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Number of worker threads. */
+#define WORKER_CNT 2
+
+/* Work that is queued and not yet started, in FIFO order.
+   Protected by disabling interrupts, since work may be queued
+   from an interrupt handler. */
+static struct list work_list;
+
+/* Upped once for each work item queued.  A worker that wakes up
+   to find the list empty, because the item was cancelled, just
+   goes back to sleep. */
+static struct semaphore work_ready;
+
+/* Worker threads, and how many of them are running work. */
+static struct thread *workers[WORKER_CNT];
+static int busy_cnt;
+
+/* Threads waiting in flush_workqueue(), and the semaphore they
+   wait on. */
+static int flush_waiters;
+static struct semaphore flush_done;
+
+/* Statistics. */
+static long long queued_cnt;    /* Work items queued. */
+static long long batched_cnt;   /* Queued while already pending. */
+static long long run_cnt;       /* Work items run. */
+
+static thread_func worker;
+static void delayed_work_fire (void *dwork_);
+static void wake_flushers (void);
+static bool is_worker (const struct thread *);
+
+/* Starts the worker threads.  Called by thread_start(). */
+void
+workqueue_init (void) {
+	struct semaphore started;
+	int i;
+
+	list_init (&work_list);
+	sema_init (&work_ready, 0);
+	sema_init (&flush_done, 0);
+
+	sema_init (&started, 0);
+	for (i = 0; i < WORKER_CNT; i++) {
+		char name[16];
+
+		snprintf (name, sizeof name, "kworker/%d", i);
+		thread_create (name, PRI_DEFAULT, worker, &started);
+		sema_down (&started);
+	}
+}
+
+/* Prints workqueue statistics. */
+void
+workqueue_print_stats (void) {
+	printf ("Workqueue: %lld queued, %lld batched, %lld run\n",
+			queued_cnt, batched_cnt, run_cnt);
+}
+
+/* Initializes WORK to call FUNC (AUX) when it runs. */
+void
+work_init (struct work *work, work_func *func, void *aux) {
+	ASSERT (work != NULL);
+	ASSERT (func != NULL);
+
+	work->func = func;
+	work->aux = aux;
+	work->pending = false;
+}
+
+/* Queues WORK to run on a worker thread.  Returns true if it was
+   queued, false if it was already pending.  May be called from
+   an interrupt handler. */
+bool
+queue_work (struct work *work) {
+	enum intr_level old_level;
+	bool queued = false;
+
+	ASSERT (work != NULL);
+
+	old_level = intr_disable ();
+	if (!work->pending) {
+		work->pending = true;
+		list_push_back (&work_list, &work->elem);
+		queued_cnt++;
+		sema_up (&work_ready);
+		queued = true;
+	} else
+		batched_cnt++;
+	intr_set_level (old_level);
+
+	return queued;
+}
+
+/* Removes WORK from the queue if it is pending.  Returns true if
+   it was pending, false if it was not queued or has already
+   started.  May be called from an interrupt handler. */
+bool
+cancel_work (struct work *work) {
+	enum intr_level old_level;
+	bool was_pending;
+
+	ASSERT (work != NULL);
+
+	old_level = intr_disable ();
+	was_pending = work->pending;
+	if (was_pending) {
+		list_remove (&work->elem);
+		work->pending = false;
+		wake_flushers ();
+	}
+	intr_set_level (old_level);
+
+	return was_pending;
+}
+
+/* Initializes DWORK to call FUNC (AUX) when it runs. */
+void
+delayed_work_init (struct delayed_work *dwork, work_func *func, void *aux) {
+	ASSERT (dwork != NULL);
+
+	work_init (&dwork->work, func, aux);
+	timer_event_init (&dwork->timer, delayed_work_fire, dwork);
+}
+
+/* Queues DWORK to run on a worker thread once TICKS timer ticks
+   have passed, or right away if TICKS <= 0.  Returns true if it
+   was queued, false if it was already waiting or pending.  May
+   be called from an interrupt handler. */
+bool
+queue_delayed_work (struct delayed_work *dwork, int64_t ticks) {
+	enum intr_level old_level;
+	bool queued = false;
+
+	ASSERT (dwork != NULL);
+
+	if (ticks <= 0)
+		return queue_work (&dwork->work);
+
+	old_level = intr_disable ();
+	if (!dwork->work.pending && !timer_event_pending (&dwork->timer)) {
+		timer_event_arm (&dwork->timer, timer_ticks () + ticks);
+		queued = true;
+	}
+	intr_set_level (old_level);
+
+	return queued;
+}
+
+/* Cancels DWORK if it is waiting for its delay or pending.
+   Returns true if it was, false if it was not queued or has
+   already started.  May be called from an interrupt handler. */
+bool
+cancel_delayed_work (struct delayed_work *dwork) {
+	ASSERT (dwork != NULL);
+
+	return timer_event_cancel (&dwork->timer) || cancel_work (&dwork->work);
+}
+
+/* Waits until every work item queued so far has run and no
+   worker is busy.  Must not be called by a worker, which would
+   wait for itself.  Work queued while waiting also delays the
+   return, so a steady stream of new work can hold off a flush. */
+void
+flush_workqueue (void) {
+	enum intr_level old_level;
+
+	ASSERT (!intr_context ());
+	ASSERT (!is_worker (thread_current ()));
+
+	old_level = intr_disable ();
+	if (!list_empty (&work_list) || busy_cnt > 0) {
+		flush_waiters++;
+		sema_down (&flush_done);
+	}
+	intr_set_level (old_level);
+}
+
+/* Timer event function for delayed work DWORK_. */
+static void
+delayed_work_fire (void *dwork_) {
+	struct delayed_work *dwork = dwork_;
+
+	queue_work (&dwork->work);
+}
+
+/* Worker thread.  Runs queued work items one at a time, forever.
+   STARTED_ is upped once the thread has registered itself. */
+static void
+worker (void *started_) {
+	struct semaphore *started = started_;
+	int i;
+
+	for (i = 0; i < WORKER_CNT; i++)
+		if (workers[i] == NULL) {
+			workers[i] = thread_current ();
+			break;
+		}
+	sema_up (started);
+
+	for (;;) {
+		enum intr_level old_level;
+		struct work *work;
+		work_func *func;
+		void *aux;
+
+		sema_down (&work_ready);
+
+		old_level = intr_disable ();
+		if (list_empty (&work_list)) {
+			intr_set_level (old_level);
+			continue;
+		}
+		work = list_entry (list_pop_front (&work_list), struct work, elem);
+		work->pending = false;
+		func = work->func;
+		aux = work->aux;
+		busy_cnt++;
+		intr_set_level (old_level);
+
+		/* FUNC may free or requeue WORK, so WORK is not touched
+		   after this point. */
+		func (aux);
+
+		old_level = intr_disable ();
+		run_cnt++;
+		busy_cnt--;
+		wake_flushers ();
+		intr_set_level (old_level);
+	}
+}
+
+/* Wakes the threads waiting in flush_workqueue() if no work is
+   left queued or running.  Interrupts must be off. */
+static void
+wake_flushers (void) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (busy_cnt == 0 && list_empty (&work_list))
+		for (; flush_waiters > 0; flush_waiters--)
+			sema_up (&flush_done);
+}
+
+/* Returns true if T is a worker thread. */
+static bool
+is_worker (const struct thread *t) {
+	int i;
+
+	for (i = 0; i < WORKER_CNT; i++)
+		if (workers[i] == t)
+			return true;
+	return false;
+}
@@ -14,10 +14,14 @@
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/mmu.h"
 #include "threads/palloc.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#include "threads/workqueue.h"
 #include "userprog/gdt.h"
 #include "userprog/syscall.h"
 #include "userprog/tss.h"
@@ -29,6 +33,48 @@ static void process_cleanup(void);
 static bool load(const char *file_name, struct intr_frame *if_);
 static void initd(void *f_name);
 static void __do_fork(void *);
+static bool process_reap(struct thread *);
+static void reap_address_spaces(void *aux);
+
+/* An exited process's address space, waiting for the reaper. */
+struct dead_mm
+{
+    struct list_elem elem; /* Element in reap_list. */
+    uint64_t *pml4;        /* Page table, with the user frames. */
+#ifdef VM
+    struct hash spt; /* Supplemental page table. */
+#endif
+};
+
+/* Address spaces of exited processes are torn down in the
+   background by reap_work, on the workqueue, so that exit and
+   wait do not take time proportional to the size of the address
+   space.  reap_list holds them until then. */
+static struct list reap_list;
+static struct lock reap_lock; /* Protects reap_list and reap_pending. */
+static struct work reap_work;
+static int reap_pending; /* Address spaces queued or being torn down. */
+
+/* Caches for the small objects made on every fork, exit and
+   lazily loaded page. */
+struct kmem_cache *lazy_load_cachep;
+static struct kmem_cache *fork_data_cachep;
+static struct kmem_cache *dead_mm_cachep;
+
+/* Sets up the object caches and the reaper.  Called once, at
+   boot. */
+void process_system_init(void)
+{
+    lazy_load_cachep =
+        kmem_cache_create("lazy_load", sizeof(struct lazy_load_data), NULL);
+    fork_data_cachep =
+        kmem_cache_create("fork_data", sizeof(struct fork_data), NULL);
+    dead_mm_cachep = kmem_cache_create("dead_mm", sizeof(struct dead_mm), NULL);
+
+    list_init(&reap_list);
+    lock_init(&reap_lock);
+    work_init(&reap_work, reap_address_spaces, NULL);
+}
 
 /* General process initializer for initd and other process. */
 static void process_init(void)
@@ -92,7 +138,7 @@ tid_t process_fork(const char *name, struct intr_frame *if_)
 {
     tid_t child_tid;
     struct thread *child;
-    struct fork_data *data = malloc(sizeof(struct fork_data));
+    struct fork_data *data = kmem_cache_alloc(fork_data_cachep);
     if (data == NULL)
     {
         return -1;
@@ -103,10 +149,12 @@ tid_t process_fork(const char *name, struct intr_frame *if_)
 
     /* Clone current thread to new thread.*/
     child_tid = thread_create(name, PRI_DEFAULT, __do_fork, data);
+    if (child_tid == TID_ERROR && process_reap_wait())
+        child_tid = thread_create(name, PRI_DEFAULT, __do_fork, data);
 
     if (child_tid == TID_ERROR)
     {
-        free(data);
+        kmem_cache_free(fork_data_cachep, data);
         return TID_ERROR;
     }
 
@@ -174,7 +222,7 @@ static void __do_fork(void *aux)
     struct intr_frame if_;
     struct thread *parent = fork_aux->parent;
     struct intr_frame *parent_if = fork_aux->if_ptr;
-    free(aux);
+    kmem_cache_free(fork_data_cachep, aux);
     struct thread *current = thread_current();
     bool succ = true;
 
@@ -183,6 +231,8 @@ static void __do_fork(void *aux)
 
     /* 2. Duplicate PT */
     current->pml4 = pml4_create();
+    if (current->pml4 == NULL && process_reap_wait())
+        current->pml4 = pml4_create();
     if (current->pml4 == NULL) goto error;
 
     process_activate(current);
@@ -226,6 +276,7 @@ int process_exec(void *f_name)
 
     // 2. 새로운 인터럽트 프레임 준비
     struct intr_frame _if;
+    memset(&_if, 0, sizeof _if);  // 스택 페이지는 재사용되므로 비워 둔다
     _if.ds = _if.es = _if.ss = SEL_UDSEG;  // 사용자 데이터 세그먼트
     _if.cs = SEL_UCSEG;                    // 사용자 코드 세그먼트
     _if.eflags = FLAG_IF | FLAG_MBS;       // 인터럽트 활성화 + 기본 플래그
@@ -311,12 +362,104 @@ void process_exit(void)
     }
 
     free(curr->fdt);
-    process_cleanup();
+
+#ifdef VM
+    /* The parent may look at a file we mapped as soon as it has our
+       exit status, so write modified mmap pages back now rather than
+       leaving that to the reaper. */
+    if (curr->pml4 != NULL) supplemental_page_table_writeback(&curr->spt);
+#endif
+
+    /* Let the reaper free the frames and page table, so that the
+       parent gets our exit status right away. */
+    if (!process_reap(curr)) process_cleanup();
 
     sema_up(&curr->wait_sema);
     sema_down(&curr->exit_sema);
 }
 
+/* Detaches T's address space from T, which must be the running
+   thread, and queues it for the reaper.  Returns false, leaving
+   the address space in place, if T has none or if memory is too
+   short to queue it. */
+static bool process_reap(struct thread *t)
+{
+    struct dead_mm *mm;
+
+    ASSERT(t == thread_current());
+
+    if (t->pml4 == NULL) return false;
+    mm = kmem_cache_alloc(dead_mm_cachep);
+    if (mm == NULL) return false;
+
+    /* As in process_cleanup(), clear T's page table pointer before
+       switching away from it. */
+    mm->pml4 = t->pml4;
+    t->pml4 = NULL;
+    pml4_activate(NULL);
+#ifdef VM
+    /* The hash's buckets are separately allocated, so the table can
+       be moved by copying it. */
+    mm->spt = t->spt.spt_table;
+#endif
+
+    lock_acquire(&reap_lock);
+    list_push_back(&reap_list, &mm->elem);
+    reap_pending++;
+    lock_release(&reap_lock);
+
+    /* If the reaper is already pending, it picks this one up in the
+       same run. */
+    queue_work(&reap_work);
+    return true;
+}
+
+/* Waits for the reaper to finish with every address space queued
+   so far.  Returns true if there were any, so that a caller that
+   ran short of memory knows it is worth retrying. */
+bool process_reap_wait(void)
+{
+    bool pending;
+
+    lock_acquire(&reap_lock);
+    pending = reap_pending > 0;
+    lock_release(&reap_lock);
+
+    if (pending) flush_workqueue();
+    return pending;
+}
+
+/* Work function that tears down every queued address space. */
+static void reap_address_spaces(void *aux UNUSED)
+{
+    for (;;)
+    {
+        struct dead_mm *mm;
+
+        lock_acquire(&reap_lock);
+        if (list_empty(&reap_list))
+        {
+            lock_release(&reap_lock);
+            break;
+        }
+        mm = list_entry(list_pop_front(&reap_list), struct dead_mm, elem);
+        lock_release(&reap_lock);
+
+        /* The pages' destroy functions find the page table through
+           each page's frame, so we stay on the kernel page table,
+           and the time is not counted as a user program's. */
+#ifdef VM
+        hash_destroy(&mm->spt, hash_page_destroy);
+#endif
+        pml4_destroy(mm->pml4);
+        kmem_cache_free(dead_mm_cachep, mm);
+
+        lock_acquire(&reap_lock);
+        reap_pending--;
+        lock_release(&reap_lock);
+    }
+}
+
 /* Free the current process's resources. */
 static void process_cleanup(void)
 {  // 현재 스레드를 위해 할당한 페이지를 해제
@@ -444,6 +587,7 @@ static bool load(const char *file_name, struct intr_frame *if_)
 
     /* Allocate and activate page directory. */
     t->pml4 = pml4_create();  // 새로운 페이지 할당
+    if (t->pml4 == NULL && process_reap_wait()) t->pml4 = pml4_create();
     if (t->pml4 == NULL) goto done;
     process_activate(thread_current());  // 새로운 스레드의 페이지 테이블 활성화
 
@@ -763,13 +907,13 @@ bool lazy_load_segment(struct page *page, void *aux)
     if (file_read_at(data->file, kva, data->page_read_bytes, data->ofs) !=
         (int) data->page_read_bytes)
     {
-        free(data);
+        kmem_cache_free(lazy_load_cachep, data);
         palloc_free_page(kva);
         return false;
     }
     memset(kva + data->page_read_bytes, 0, data->page_zero_bytes);
 
-    free(data);
+    kmem_cache_free(lazy_load_cachep, data);
     return true;
 }
 
@@ -804,8 +948,7 @@ static bool load_segment(struct file *file, off_t ofs, uint8_t *upage,
         size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
         /* TODO: Set up aux to pass information to the lazy_load_segment. */
-        struct lazy_load_data *data =
-            (struct lazy_load_data *) malloc(sizeof(struct lazy_load_data));
+        struct lazy_load_data *data = kmem_cache_alloc(lazy_load_cachep);
         if (data == NULL) return false;
 
         data->file = file;
@@ -816,7 +959,7 @@ static bool load_segment(struct file *file, off_t ofs, uint8_t *upage,
         if (!vm_alloc_page_with_initializer(VM_ANON, upage, writable,
                                             lazy_load_segment, data))
         {
-            free(data);
+            kmem_cache_free(lazy_load_cachep, data);
             return false;
         }
 
@@ -12,6 +12,7 @@
 #include "threads/loader.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 #include "userprog/gdt.h"
 #include "userprog/process.h"
 
@@ -53,6 +54,7 @@ void syscall_handler(struct intr_frame *f)
 {
     thread_current()->rsp = f->rsp;
     uint64_t sys_numer = f->R.rax;
+    TRACE(TRACE_SYSCALL, sys_numer, f->R.rdi, f->R.rsi, f->R.rdx);
     switch (sys_numer)
     {
         case SYS_HALT:
@@ -130,7 +132,15 @@ void syscall_handler(struct intr_frame *f)
         case SYS_MUNMAP:
             munmap(f->R.rdi);
             break;
+        case SYS_SCHED_STATS:
+            f->R.rax =
+                sched_stats(f->R.rdi, (struct sched_stats *) f->R.rsi);
+            break;
+        case SYS_CLOCK_GETTIME:
+            f->R.rax = clock_gettime(f->R.rdi, (struct timespec *) f->R.rsi);
+            break;
     }
+    TRACE(TRACE_SYSCALL_DONE, sys_numer, f->R.rax);
     // thread_exit ();
 }
 
@@ -311,6 +321,50 @@ void munmap(void *addr)
     lock_release(&global_lock);
 }
 
+/* PID 프로세스의 스케줄링 통계를 STATS에 복사한다.
+   PID가 0이면 현재 프로세스의 통계를 복사하고,
+   그런 프로세스가 없으면 -1을 반환한다. */
+int sched_stats(tid_t pid, struct sched_stats *stats)
+{
+    struct sched_stats copy;
+
+    is_valid_pointer(stats);
+    is_valid_pointer((uint8_t *) stats + sizeof *stats - 1);
+
+    if (pid == 0) pid = thread_tid();
+    if (!thread_get_sched_stats(pid, &copy)) return -1;
+
+    *stats = copy;
+    return 0;
+}
+
+/* CLOCK_ID 시계의 현재 값을 TS에 기록한다.
+   CLOCK_MONOTONIC은 부팅 이후 경과 시간, CLOCK_PROCESS_CPUTIME_ID는
+   현재 프로세스가 사용한 CPU 시간이다. 모르는 시계면 -1을 반환한다. */
+int clock_gettime(int clock_id, struct timespec *ts)
+{
+    int64_t ns;
+
+    is_valid_pointer(ts);
+    is_valid_pointer((uint8_t *) ts + sizeof *ts - 1);
+
+    if (clock_id == CLOCK_MONOTONIC)
+        ns = timer_ns();
+    else if (clock_id == CLOCK_PROCESS_CPUTIME_ID)
+    {
+        struct sched_stats stats;
+
+        thread_get_sched_stats(thread_tid(), &stats);
+        ns = timer_cycles_to_ns(stats.run_cycles);
+    }
+    else
+        return -1;
+
+    ts->tv_sec = ns / 1000000000;
+    ts->tv_nsec = ns % 1000000000;
+    return 0;
+}
+
 static void is_valid_pointer(void *ptr)
 {
     if (ptr == NULL || is_kernel_vaddr(ptr)) exit(-1);
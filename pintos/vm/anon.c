@@ -2,6 +2,7 @@
 /* anon.c: 디스크 이미지가 아닌 페이지의 구현 (즉, 익명 페이지). */
 
 #include "devices/disk.h"
+#include "vm/compact.h"
 #include "vm/vm.h"
 #include "lib/kernel/bitmap.h"
 
@@ -63,4 +64,7 @@ static bool anon_swap_out(struct page *page)
 static void anon_destroy(struct page *page)
 {
     struct anon_page *anon_page = &page->anon;
+
+    /* 페이지 테이블이 프레임을 해제하기 전에 압축 대상에서 뺍니다. */
+    if (page->frame != NULL) vm_frame_unregister(page->frame);
 }
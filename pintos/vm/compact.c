@@ -0,0 +1,259 @@
+/* compact.c: 물리 메모리 압축(compaction)을 구현합니다. */
+
+#include "vm/compact.h"
+
+#include <list.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "devices/timer.h"
+#include "intrinsic.h"
+#include "threads/interrupt.h"
+#include "threads/mmu.h"
+#include "threads/pte.h"
+#include "threads/vaddr.h"
+#include "threads/workqueue.h"
+#include "vm/vm.h"
+
+/* 사용자 풀의 여유 페이지가 흩어져 있으면 연속된 여러 페이지를 요구하는
+ * 할당이 실패합니다. 압축은 palloc_isolate()가 고른 정렬된 블록에서
+ * 사용자 프레임을 블록 밖의 새 페이지로 옮기고(migration), 그 프레임을
+ * 매핑한 페이지 테이블 항목과 frame->kva를 고친 뒤 블록을 통째로
+ * 돌려줍니다.
+ *
+ * palloc_get_multiple()이 실패하면 그 요청을 위해 바로 압축하고, 워크큐에
+ * 백그라운드 압축도 예약합니다. 백그라운드 압축은 사용자 풀이
+ * COMPACT_PAGES 페이지 블록을 만들 수 없을 만큼 흩어져 있을 때만 한
+ * 블록을 비우고, 블록을 비우는 데 성공했는데도 여전히 흩어져 있으면
+ * COMPACT_INTERVAL 틱 뒤에 다시 실행됩니다. 진전이 없으면 다음 할당
+ * 실패까지 멈추므로, 할 일이 없을 때 타이머를 깨우지 않습니다.
+ *
+ * 한 번의 압축은 블록 하나만 다룹니다. 프레임 하나를 옮길 때마다, 또
+ * 옮길 프레임을 찾느라 COMPACT_SCAN개의 프레임을 지날 때마다 인터럽트를
+ * 잠시 켜므로 인터럽트가 꺼져 있는 시간은 프레임 하나 분량입니다. 그
+ * 사이에 블록 안에서 해제되는 페이지는 palloc이 블록을 위해 붙잡아
+ * 둡니다. 고정된 프레임은 옮기지 않습니다.
+ *
+ * 프레임을 옮기는 동안에는 인터럽트를 끄므로, 사용자 주소로 접근하는
+ * 코드는 옮겨진 뒤의 매핑을 봅니다. 커널 주소(kva)로 프레임 내용에
+ * 접근하는 동안에는 vm_frame_pin()으로 프레임을 고정해야 합니다. */
+
+/* 백그라운드 압축이 만들어 두려는 블록의 페이지 수와 재실행 간격. */
+#define COMPACT_PAGES 16
+#define COMPACT_INTERVAL TIMER_FREQ
+
+/* 인터럽트를 다시 켜기 전까지 지나칠 수 있는 프레임 수. */
+#define COMPACT_SCAN 64
+
+/* 페이지 테이블에 매핑된, 옮길 수 있는 모든 프레임의 목록.
+ * 인터럽트를 꺼서 보호합니다. */
+static struct list frame_list;
+
+/* 압축 중인지 여부와, 압축이 frame_list에서 다음에 볼 원소. 인터럽트를
+ * 켠 사이에 이 원소의 등록이 해제되면 vm_frame_unregister()가 다음
+ * 원소로 옮깁니다. 인터럽트를 꺼서 보호합니다. */
+static bool compacting;
+static struct list_elem *cursor;
+
+static struct delayed_work compact_work;
+
+/* 통계. */
+static long long direct_cnt;     /* 할당 실패로 실행된 압축. */
+static long long direct_ok;      /* 그 중 블록을 비운 횟수. */
+static long long bg_cnt;         /* 백그라운드로 실행된 압축. */
+static long long bg_ok;          /* 그 중 블록을 비운 횟수. */
+static long long migrated_cnt;   /* 옮긴 프레임. */
+static long long failed_cnt;     /* 옮기지 못한 프레임. */
+
+static bool compact(enum palloc_flags flags, size_t page_cnt);
+static bool migrate_frame(struct frame *f);
+static void compact_kcompactd(void *aux);
+
+/* 프레임 목록과 백그라운드 압축을 초기화합니다. vm_init()에서
+ * 호출됩니다. */
+void vm_compact_init(void)
+{
+    list_init(&frame_list);
+    delayed_work_init(&compact_work, compact_kcompactd, NULL);
+}
+
+/* PML4에 매핑되고 내용이 채워진 프레임 F를 옮길 수 있는 프레임으로
+ * 등록합니다. */
+void vm_frame_register(struct frame *f, uint64_t *pml4)
+{
+    enum intr_level old_level = intr_disable();
+
+    f->pml4 = pml4;
+    list_push_back(&frame_list, &f->f_elem);
+    palloc_set_movable(f->kva, true);
+    intr_set_level(old_level);
+}
+
+/* 프레임 F의 등록을 해제합니다. 페이지 테이블이 F의 페이지를 해제하기
+ * 전에 호출해야 합니다. 등록되지 않은 프레임이면 아무것도 하지
+ * 않습니다. */
+void vm_frame_unregister(struct frame *f)
+{
+    enum intr_level old_level = intr_disable();
+
+    if (f->pml4 != NULL)
+    {
+        if (cursor == &f->f_elem) cursor = list_next(cursor);
+        list_remove(&f->f_elem);
+        palloc_set_movable(f->kva, false);
+        f->pml4 = NULL;
+    }
+    intr_set_level(old_level);
+}
+
+/* 커널이 F->kva로 내용에 접근하는 동안 F가 옮겨지지 않도록 고정합니다. */
+void vm_frame_pin(struct frame *f)
+{
+    enum intr_level old_level = intr_disable();
+
+    if (f->pml4 != NULL) palloc_set_movable(f->kva, false);
+    intr_set_level(old_level);
+}
+
+/* vm_frame_pin()으로 고정한 F를 다시 옮길 수 있게 합니다. */
+void vm_frame_unpin(struct frame *f)
+{
+    enum intr_level old_level = intr_disable();
+
+    if (f->pml4 != NULL) palloc_set_movable(f->kva, true);
+    intr_set_level(old_level);
+}
+
+/* FLAGS로 PAGE_CNT 페이지를 요청했다가 실패했을 때 호출되어, 그만큼의
+ * 연속된 여유 페이지를 만들어 봅니다. 성공하면 true를 반환하며, 이때
+ * 다시 요청하면 성공해야 합니다. 다른 압축이 진행 중이면 false를
+ * 반환합니다. 백그라운드 압축도 예약합니다. */
+bool vm_compact(enum palloc_flags flags, size_t page_cnt)
+{
+    bool success = compact(flags, page_cnt);
+    enum intr_level old_level = intr_disable();
+
+    direct_cnt++;
+    if (success) direct_ok++;
+    intr_set_level(old_level);
+
+    queue_delayed_work(&compact_work, 0);
+    return success;
+}
+
+/* 압축 통계를 출력합니다. */
+void vm_compact_print_stats(void)
+{
+    printf("Compaction: %lld of %lld on allocation failure succeeded, "
+           "%lld of %lld in background; %lld frames migrated, %lld failed\n",
+           direct_ok, direct_cnt, bg_ok, bg_cnt, migrated_cnt, failed_cnt);
+}
+
+/* palloc_isolate()로 블록 하나를 골라 그 안의 프레임을 옮기고 블록을
+ * 돌려줍니다. 블록 전체가 비었으면 true를 반환합니다. 호출자의 인터럽트
+ * 상태가 켜져 있으면 프레임 사이사이에 인터럽트를 켭니다. */
+static bool compact(enum palloc_flags flags, size_t page_cnt)
+{
+    enum intr_level old_level = intr_disable();
+    uint8_t *block;
+    size_t block_cnt;
+    size_t scanned = 0;
+    bool success;
+
+    if (compacting)
+    {
+        intr_set_level(old_level);
+        return false;
+    }
+    block = palloc_isolate(flags, page_cnt, &block_cnt);
+    if (block == NULL)
+    {
+        intr_set_level(old_level);
+        return false;
+    }
+    compacting = true;
+
+    /* 새로 등록되는 프레임은 블록 밖에 있고 목록 끝에 붙으므로, 목록을
+     * 한 번 훑으면 블록 안의 프레임을 모두 만납니다. */
+    cursor = list_begin(&frame_list);
+    while (cursor != list_end(&frame_list))
+    {
+        struct frame *f = list_entry(cursor, struct frame, f_elem);
+        uint8_t *kva = f->kva;
+
+        cursor = list_next(cursor);
+        if (kva >= block && kva < block + PGSIZE * block_cnt)
+        {
+            if (migrate_frame(f))
+                migrated_cnt++;
+            else
+                failed_cnt++;
+        }
+        else if (++scanned % COMPACT_SCAN != 0)
+            continue;
+
+        /* 기다리던 인터럽트를 받습니다. */
+        intr_set_level(old_level);
+        intr_disable();
+    }
+
+    compacting = false;
+    cursor = NULL;
+    success = palloc_release_isolated(block, block_cnt);
+    intr_set_level(old_level);
+    return success;
+}
+
+/* 프레임 F의 내용을 사용자 풀의 새 페이지로 복사하고, F를 매핑한 페이지
+ * 테이블 항목과 F->kva가 새 페이지를 가리키게 한 뒤 원래 페이지를
+ * 해제합니다. F가 고정되어 있거나 새 페이지가 없으면 false를 반환합니다.
+ * 인터럽트가 꺼진 채로 호출해야 합니다. */
+static bool migrate_frame(struct frame *f)
+{
+    uint64_t va = (uint64_t) f->page->va;
+    void *old_kva = f->kva;
+    uint64_t *pte;
+    void *kva;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (!palloc_movable(old_kva)) return false;
+    kva = palloc_get_page(PAL_USER);
+    if (kva == NULL) return false;
+    memcpy(kva, f->kva, PGSIZE);
+
+    /* 접근/수정 비트를 포함한 플래그는 그대로 둡니다. munmap 등으로
+     * 매핑이 이미 지워졌다면 페이지 테이블은 고칠 필요가 없습니다. */
+    pte = pml4e_walk(f->pml4, va, false);
+    if (pte != NULL && (*pte & PTE_P) && ptov(PTE_ADDR(*pte)) == f->kva)
+    {
+        *pte = vtop(kva) | (*pte & PTE_FLAGS);
+        if (rcr3() == vtop(f->pml4)) invlpg(va);
+    }
+
+    palloc_set_movable(old_kva, false);
+    palloc_set_movable(kva, true);
+    f->kva = kva;
+    palloc_free_page(old_kva);
+    return true;
+}
+
+/* 사용자 풀이 흩어져 있으면 COMPACT_PAGES 페이지 블록을 하나 비웁니다.
+ * 블록을 비웠는데도 여전히 흩어져 있을 때만 다음 실행을 예약합니다.
+ * 워크큐에서 실행됩니다. */
+static void compact_kcompactd(void *aux UNUSED)
+{
+    enum intr_level old_level;
+    bool progress;
+
+    if (!palloc_fragmented(COMPACT_PAGES)) return;
+
+    progress = compact(PAL_USER, COMPACT_PAGES);
+    old_level = intr_disable();
+    bg_cnt++;
+    if (progress) bg_ok++;
+    intr_set_level(old_level);
+
+    if (progress && palloc_fragmented(COMPACT_PAGES))
+        queue_delayed_work(&compact_work, COMPACT_INTERVAL);
+}
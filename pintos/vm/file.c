@@ -7,6 +7,8 @@
 #include "include/threads/mmu.h"
 #include "include/threads/vaddr.h"
 #include "include/userprog/process.h"
+#include "threads/slab.h"
+#include "vm/compact.h"
 #include "vm/vm.h"
 
 static bool file_backed_swap_in(struct page *page, void *kva);
@@ -55,18 +57,48 @@ static bool file_backed_swap_out(struct page *page)
     struct file_page *file_page UNUSED = &page->file;
 }
 
-/* 파일 백업 페이지를 파괴합니다. PAGE는 호출자에 의해 해제됩니다. */
-static void file_backed_destroy(struct page *page)
+/* PAGE가 PML4에서 수정되었으면 프레임의 내용을 파일에 다시 쓰고 dirty
+ * 비트를 지웁니다. 프레임은 커널 주소로 읽으므로 PML4가 활성화되어 있지
+ * 않아도 됩니다. 호출자는 그동안 프레임이 옮겨지지 않게 해야 합니다. */
+static void write_back(struct page *page, uint64_t *pml4)
 {
-    struct file_page *file_page UNUSED = &page->file;
-    struct thread *cur = thread_current();
-    if (pml4_is_dirty(cur->pml4, page->va))
+    struct file_page *file_page = &page->file;
+
+    if (pml4_is_dirty(pml4, page->va))
     {
-        file_write_at(file_page->file, page->va, file_page->read_bytes,
-                      file_page->offset);
-        pml4_set_dirty(cur->pml4, page->va, false);
+        file_write_at(file_page->file, page->frame->kva,
+                      file_page->read_bytes, file_page->offset);
+        pml4_set_dirty(pml4, page->va, false);
     }
-    pml4_clear_page(cur->pml4, page->va);
+}
+
+/* PAGE가 수정되었으면 내용을 파일에 다시 쓰고 dirty 비트를 지웁니다. */
+void file_backed_writeback(struct page *page)
+{
+    struct frame *frame = page->frame;
+
+    if (frame == NULL || frame->pml4 == NULL) return;
+    vm_frame_pin(frame);
+    write_back(page, frame->pml4);
+    vm_frame_unpin(frame);
+}
+
+/* 파일 백업 페이지를 파괴합니다. PAGE는 호출자에 의해 해제됩니다.
+ * 매핑한 페이지 테이블은 프레임에서 찾으므로, 실행 중인 스레드의
+ * 페이지 테이블이 아니어도 됩니다. */
+static void file_backed_destroy(struct page *page)
+{
+    struct frame *frame = page->frame;
+    uint64_t *pml4;
+
+    if (frame == NULL || frame->pml4 == NULL) return;
+
+    /* 페이지 테이블이 프레임을 해제하기 전에 압축 대상에서 뺍니다.
+     * 그러면 프레임이 더는 옮겨지지 않습니다. */
+    pml4 = frame->pml4;
+    vm_frame_unregister(frame);
+    write_back(page, pml4);
+    pml4_clear_page(pml4, page->va);
 }
 
 /* mmap을 수행합니다 */
@@ -92,8 +124,7 @@ void *do_mmap(void *addr, size_t length, int writable, struct file *file,
         size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
         size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
-        struct lazy_load_data *data =
-            (struct lazy_load_data *) malloc(sizeof(struct lazy_load_data));
+        struct lazy_load_data *data = kmem_cache_alloc(lazy_load_cachep);
         if (data == NULL) return false;
 
         data->file = f;
@@ -104,7 +135,7 @@ void *do_mmap(void *addr, size_t length, int writable, struct file *file,
         if (!vm_alloc_page_with_initializer(VM_FILE, addr, writable,
                                             lazy_load_segment, data))
         {
-            free(data);
+            kmem_cache_free(lazy_load_cachep, data);
             return NULL;
         }
 
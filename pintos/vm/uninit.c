@@ -9,6 +9,8 @@
 
 #include "vm/vm.h"
 #include "vm/uninit.h"
+#include "threads/slab.h"
+#include "userprog/process.h"
 
 
 static bool uninit_initialize(struct page *page, void *kva);
@@ -63,5 +65,5 @@ static void uninit_destroy(struct page *page)
     struct uninit_page *uninit UNUSED = &page->uninit;
     /* TODO: 이 함수를 채우세요.
      * TODO: 할 일이 없다면 그냥 return하세요. */
-    free(page->uninit.aux);
+    kmem_cache_free(lazy_load_cachep, page->uninit.aux);
 }
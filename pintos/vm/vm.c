@@ -8,8 +8,16 @@
 #include "include/userprog/process.h"
 #include "include/userprog/syscall.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
+#include "threads/trace.h"
+#include "vm/compact.h"
 #include "vm/inspect.h"
 
+/* struct page와 struct frame은 페이지마다 하나씩 만들어지므로 전용
+ * 캐시에서 할당합니다. */
+static struct kmem_cache *page_cachep;
+static struct kmem_cache *frame_cachep;
+
 /* 각 하위 시스템의 초기화 코드를 호출하여 가상 메모리 하위 시스템을
  * 초기화합니다. */
 void vm_init(void)
@@ -23,6 +31,9 @@ void vm_init(void)
     /* 위의 라인들은 수정하지 마세요. */
     /* TODO: 여러분의 코드가 여기에 들어갑니다. */
     list_init(&thread_current()->spt.frame_table);
+    page_cachep = kmem_cache_create("page", sizeof(struct page), NULL);
+    frame_cachep = kmem_cache_create("frame", sizeof(struct frame), NULL);
+    vm_compact_init();
 }
 
 /* 페이지의 타입을 가져옵니다. 이 함수는 페이지가 초기화된 후의 타입을 알고 싶을
@@ -44,6 +55,8 @@ static struct frame *vm_get_victim(void);
 static bool vm_do_claim_page(struct page *page);
 static struct frame *vm_evict_frame(void);
 static void vm_stack_growth(void *addr);
+static bool handle_fault(struct intr_frame *f, void *addr, bool user,
+                         bool write, bool not_present);
 
 /* 초기화 함수와 함께 대기 중인 페이지 객체를 생성합니다. 페이지를 생성하려면
  * 직접 생성하지 말고 이 함수나 `vm_alloc_page`를 통해 생성하세요. */
@@ -61,7 +74,7 @@ bool vm_alloc_page_with_initializer(enum vm_type type, void *upage,
         return false;
     }
 
-    struct page *page = malloc(sizeof(struct page));
+    struct page *page = kmem_cache_alloc(page_cachep);
     if (page == NULL) return false;
 
     /* TODO: 페이지를 생성하고, VM 타입에 따라 초기화 함수를 가져와서
@@ -93,15 +106,13 @@ struct page *spt_find_page(struct supplemental_page_table *spt UNUSED,
     /* spt에서 va(가상주소)에 대응하는 페이지를 찾는다. */
     /* 실패시 NULL */
     /* TODO: 이 함수를 구현하세요. */
-    struct page *page = malloc(sizeof(struct page));
-    if (page == NULL) return NULL;
-
+    /* 검색 키로만 쓰이므로 할당하지 않고 스택에 둡니다. */
+    struct page key;
     struct hash_elem *e;
 
-    page->va = pg_round_down(va);
-    e = hash_find(&spt->spt_table, &page->h_elem);
+    key.va = pg_round_down(va);
+    e = hash_find(&spt->spt_table, &key.h_elem);
 
-    free(page);
     return e != NULL ? hash_entry(e, struct page, h_elem) : NULL;
 }
 
@@ -145,10 +156,12 @@ static struct frame *vm_evict_frame(void)
  * 제거합니다.*/
 static struct frame *vm_get_frame(void)
 {
-    struct frame *frame = malloc(sizeof(struct frame));
+    struct frame *frame = kmem_cache_alloc(frame_cachep);
     if (frame == NULL) return NULL;
 
     void *kva = palloc_get_page(PAL_USER);
+    /* 종료된 프로세스의 주소 공간이 아직 해제 중이면 기다린 뒤 다시 시도 */
+    if (kva == NULL && process_reap_wait()) kva = palloc_get_page(PAL_USER);
 
     if (kva == NULL)
     {
@@ -157,6 +170,7 @@ static struct frame *vm_get_frame(void)
 
     frame->kva = kva;
     frame->page = NULL;
+    frame->pml4 = NULL;
 
     ASSERT(frame != NULL);
     ASSERT(frame->page == NULL);
@@ -184,6 +198,18 @@ static bool vm_handle_wp(struct page *page UNUSED)
 bool vm_try_handle_fault(struct intr_frame *f UNUSED, void *addr UNUSED,
                          bool user UNUSED, bool write UNUSED,
                          bool not_present UNUSED)
+{
+    bool handled;
+
+    TRACE(TRACE_PAGE_FAULT, (uintptr_t) addr, user, write, not_present);
+    handled = handle_fault(f, addr, user, write, not_present);
+    TRACE(TRACE_PAGE_FAULT_DONE, (uintptr_t) addr, handled);
+    return handled;
+}
+
+/* vm_try_handle_fault()의 본체입니다. */
+static bool handle_fault(struct intr_frame *f, void *addr, bool user,
+                         bool write, bool not_present)
 {
     struct supplemental_page_table *spt UNUSED = &thread_current()->spt;
     struct page *page = NULL;
@@ -217,7 +243,7 @@ bool vm_try_handle_fault(struct intr_frame *f UNUSED, void *addr UNUSED,
 void vm_dealloc_page(struct page *page)
 {
     destroy(page);
-    free(page);
+    kmem_cache_free(page_cachep, page);
 }
 
 /* VA에 할당된 페이지를 요청합니다. */
@@ -246,7 +272,12 @@ static bool vm_do_claim_page(struct page *page)
 
     /* Set links */
     if (pml4_set_page(cur->pml4, page->va, frame->kva, page->writable))
-        return swap_in(page, frame->kva);
+    {
+        if (!swap_in(page, frame->kva)) return false;
+        /* 내용이 채워진 뒤부터는 압축으로 옮겨질 수 있습니다. */
+        vm_frame_register(frame, cur->pml4);
+        return true;
+    }
 
     /* 가상주소와 물리 주소간 매핑 테이블에 추가 */
     /* 성공 여부를 true / false로 반환 */
@@ -282,7 +313,7 @@ bool supplemental_page_table_copy(struct supplemental_page_table *dst UNUSED,
         if (type == VM_UNINIT)
         {
             vm_initializer *init = src_page->uninit.init;
-            void *aux = malloc(sizeof(struct lazy_load_data));
+            void *aux = kmem_cache_alloc(lazy_load_cachep);
             memcpy(aux, src_page->uninit.aux, sizeof(struct lazy_load_data));
 
             vm_alloc_page_with_initializer(src_page->uninit.type, upage,
@@ -291,7 +322,7 @@ bool supplemental_page_table_copy(struct supplemental_page_table *dst UNUSED,
         }
         else if (type == VM_FILE)
         {
-            void *aux = malloc(sizeof(struct lazy_load_data));
+            void *aux = kmem_cache_alloc(lazy_load_cachep);
             memcpy(aux, &src_page->file, sizeof(struct lazy_load_data));
 
             vm_alloc_page_with_initializer(type, upage, writable, NULL, aux);
@@ -303,12 +334,33 @@ bool supplemental_page_table_copy(struct supplemental_page_table *dst UNUSED,
             if (!vm_claim_page(upage)) return false;
         }
 
+        /* kva로 복사하는 동안 두 프레임이 옮겨지지 않도록 고정합니다. */
         struct page *dst_page = spt_find_page(dst, upage);
+        vm_frame_pin(src_page->frame);
+        vm_frame_pin(dst_page->frame);
         memcpy(dst_page->frame->kva, src_page->frame->kva, PGSIZE);
+        vm_frame_unpin(dst_page->frame);
+        vm_frame_unpin(src_page->frame);
     }
     return true;
 }
 
+/* 보조 페이지 테이블의 파일 백업 페이지 중 수정된 것을 모두 파일에 다시
+ * 씁니다. 페이지는 그대로 두므로, 나중에 파괴할 때는 다시 쓰지 않습니다. */
+void supplemental_page_table_writeback(struct supplemental_page_table *spt)
+{
+    struct hash_iterator i;
+
+    if (spt->spt_table.buckets == NULL) return;
+
+    hash_first(&i, &spt->spt_table);
+    while (hash_next(&i))
+    {
+        struct page *page = hash_entry(hash_cur(&i), struct page, h_elem);
+        if (page->operations->type == VM_FILE) file_backed_writeback(page);
+    }
+}
+
 /* Free the resource hold by the supplemental page table */
 /* 보조 페이지 테이블(supplemental_page_table)이 보유한 리소스를 해제합니다 */
 void supplemental_page_table_kill(struct supplemental_page_table *spt UNUSED)